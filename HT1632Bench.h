@@ -0,0 +1,221 @@
+/*
+ * HT1632C Driver for Arduino by Luis M. Ruiz - stendall@gmail.com
+ * http://code.google.com/p/ht1632c-driver/
+ *
+ * Licensed as : CC BY-NC-SA 3.0
+ * For more details see:
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/
+ */
+
+#ifndef HT1632BENCH_H_h
+#define HT1632BENCH_H_h
+
+#include "HT1632C.h"
+
+/*
+ * Microbenchmarks of the drawing functions and of writeScreen(), the same on
+ * the board (examples/Benchmark) and on the host (ht1632_bench). Each case
+ * runs for HT1632_BENCH_TIME us and prints over Serial its rate, ops/s or
+ * frames/s, and the cost of one: CPU cycles at F_CPU on the board, ns on
+ * the host (its clock isn't F_CPU).
+ *
+ *   HT1632Fast<5, 4, 6> matrix;
+ *   matrix.init();
+ *   HT1632Bench::run("HT1632Fast", matrix, HT1632_MODULE_8X32, 1);
+ *
+ * runLanes() times writeScreen() and writeScreenLanes() on a lanes pin set
+ * (HT1632Lanes), the same frame one chip at a time and all at once.
+ *
+ * The screen size comes from the module type and the chips, the modules
+ * stacked (init() default). The run ends with the screen cleared.
+ *
+ * micros() loses the timer 0 overflows while writeScreen() has the
+ * interrupts off, over 1 ms a frame with the runtime pins. The run sends
+ * its frames with setCriticalSection(HT1632_BENCH_CRITICAL) so the timer
+ * keeps counting, and leaves it at 0 (whole frame) at the end.
+ */
+#define HT1632_BENCH_TIME		100000UL	//us per case.
+#define HT1632_BENCH_CRITICAL	4	//Screen bytes between interrupt windows, well under 1 ms.
+
+#define HT1632_BENCH_PIXEL			0
+#define HT1632_BENCH_LINE			1	//4 cases, the octants: x or y major, y going down or up.
+#define HT1632_BENCH_FILL_RECT		5
+#define HT1632_BENCH_CIRCLE			6
+#define HT1632_BENCH_FILL_CIRCLE	7
+#define HT1632_BENCH_CHAR			8
+#define HT1632_BENCH_STRING			9
+#define HT1632_BENCH_ANIMATE		10
+#define HT1632_BENCH_FRAME			11	//Whole writeScreen().
+#define HT1632_BENCH_PIXEL_FRAME	12	//drawPixel() and writeScreen() of that byte.
+#define HT1632_BENCH_CASES			13
+#define HT1632_BENCH_LANES			13	//Whole writeScreenLanes(), runLanes() only.
+
+class HT1632Bench {
+public:
+	template<class Matrix>
+	static void run(const char * name, Matrix & matrix, byte module, byte chips) {
+		HT1632Geometry geometry = HT1632Geometry::of(module);
+		HT1632Bench bench(geometry.width(), geometry.height() * chips);
+
+		Serial.print(name);
+		Serial.print(", ");
+		Serial.print((int) bench._WIDTH);
+		Serial.print('x');
+		Serial.print((int) bench._HEIGHT);
+		Serial.print(", setCriticalSection(");
+		Serial.print(HT1632_BENCH_CRITICAL);
+		Serial.println(')');
+		matrix.setCriticalSection(HT1632_BENCH_CRITICAL);
+		for (byte test = 0; test < HT1632_BENCH_CASES; test++)
+			bench.measure(matrix, test);
+		matrix.setCriticalSection(0);
+		matrix.setActiveBuffer(0);
+		matrix.clearScreen();
+		matrix.writeScreen();
+	}
+
+	template<class Matrix>
+	static void runLanes(const char * name, Matrix & matrix, byte module, byte chips) {
+		HT1632Geometry geometry = HT1632Geometry::of(module);
+		HT1632Bench bench(geometry.width(), geometry.height() * chips);
+		unsigned long count = 0;
+		unsigned long start;
+		unsigned long elapsed;
+
+		Serial.print(name);
+		Serial.print(", lanes, setCriticalSection(");
+		Serial.print(HT1632_BENCH_CRITICAL);
+		Serial.println(')');
+		matrix.setCriticalSection(HT1632_BENCH_CRITICAL);
+		matrix.drawString(0, 1, "Bench", 1);
+		bench.measure(matrix, HT1632_BENCH_FRAME);
+		start = micros();
+		do {
+			for (byte i = 0; i < 8; i++, count++) {
+				matrix.setActiveBuffer(count & 1);
+				matrix.writeScreenLanes();
+			}
+			elapsed = micros() - start;
+		} while (elapsed < HT1632_BENCH_TIME);
+		bench.report(HT1632_BENCH_LANES, count, elapsed);
+		matrix.setCriticalSection(0);
+		matrix.setActiveBuffer(0);
+		matrix.clearScreen();
+		matrix.writeScreenLanes();
+	}
+
+private:
+	int _WIDTH;
+	int _HEIGHT;
+	int _X;		//drawPixel position, row by row.
+	int _Y;
+
+	HT1632Bench(int width, int height) {
+		_WIDTH = width;
+		_HEIGHT = height;
+		_X = 0;
+		_Y = 0;
+	}
+
+	template<class Matrix>
+	void measure(Matrix & matrix, byte test) {
+		unsigned long count = 0;
+		unsigned long start;
+		unsigned long elapsed;
+
+		matrix.setActiveBuffer(0);
+		start = micros();
+		do {
+			//Batches, micros() costs more than some cases.
+			for (byte i = 0; i < 8; i++)
+				step(matrix, test, count++);
+			elapsed = micros() - start;
+		} while (elapsed < HT1632_BENCH_TIME);
+		report(test, count, elapsed);
+	}
+
+	template<class Matrix>
+	void step(Matrix & matrix, byte test, unsigned long i) {
+		byte color = i & 1;
+		int m = _WIDTH < _HEIGHT ? _WIDTH : _HEIGHT;
+		int r = m / 2 - 1;
+
+		switch (test) {
+		case HT1632_BENCH_PIXEL:
+			matrix.drawPixel(_X, _Y, color);
+			if (++_X == _WIDTH) {
+				_X = 0;
+				if (++_Y == _HEIGHT)
+					_Y = 0;
+			}
+			break;
+		//The minor axis goes m / 2, under the major one on any screen shape.
+		case HT1632_BENCH_LINE:
+			matrix.drawLine(0, 0, _WIDTH - 1, m / 2, color);
+			break;
+		case HT1632_BENCH_LINE + 1:
+			matrix.drawLine(0, 0, m / 2, _HEIGHT - 1, color);
+			break;
+		case HT1632_BENCH_LINE + 2:
+			matrix.drawLine(0, _HEIGHT - 1, _WIDTH - 1, _HEIGHT - 1 - m / 2, color);
+			break;
+		case HT1632_BENCH_LINE + 3:
+			matrix.drawLine(0, _HEIGHT - 1, m / 2, 0, color);
+			break;
+		case HT1632_BENCH_FILL_RECT:
+			matrix.fillRect(1, 1, _WIDTH - 2, _HEIGHT - 2, color);
+			break;
+		case HT1632_BENCH_CIRCLE:
+			matrix.drawCircle(_WIDTH / 2, _HEIGHT / 2, r, color);
+			break;
+		case HT1632_BENCH_FILL_CIRCLE:
+			matrix.fillCircle(_WIDTH / 2, _HEIGHT / 2, r, color);
+			break;
+		case HT1632_BENCH_CHAR:
+			matrix.drawChar(0, 1, 'A' + (i & 15), color);
+			break;
+		case HT1632_BENCH_STRING:
+			matrix.drawString(0, 1, "Bench", color);
+			break;
+		case HT1632_BENCH_ANIMATE:
+			matrix.animateDown();
+			break;
+		case HT1632_BENCH_FRAME:
+			matrix.setActiveBuffer(color); //Not the last one sent, all of it goes.
+			matrix.writeScreen();
+			break;
+		case HT1632_BENCH_PIXEL_FRAME:
+			matrix.drawPixel(i % _WIDTH, 0, (i / _WIDTH) & 1);
+			matrix.writeScreen();
+			break;
+		}
+	}
+
+	void report(byte test, unsigned long count, unsigned long elapsed) {
+		static const char * const names[HT1632_BENCH_CASES + 1] = { "drawPixel",
+				"drawLine x dn", "drawLine y dn", "drawLine x up", "drawLine y up",
+				"fillRect", "drawCircle", "fillCircle", "drawChar", "drawString",
+				"animateDown", "writeScreen", "1 pixel frame", "lanes frame" };
+		bool frames = test >= HT1632_BENCH_FRAME;
+		unsigned long rate;
+
+		Serial.print("  ");
+		Serial.print(names[test]);
+		for (byte n = strlen(names[test]); n < 14; n++)
+			Serial.print(' ');
+		rate = (unsigned long) (count * 1000000.0 / elapsed);
+		for (unsigned long digits = 1000000000UL; digits > 1 && digits > rate; digits /= 10)
+			Serial.print(' ');
+		Serial.print(rate);
+		Serial.print(frames ? " frames/s, " : " ops/s, ");
+#ifdef HT1632_HOST
+		Serial.print(elapsed * 1000.0 / count, 1);
+		Serial.println(frames ? " ns/frame" : " ns/op");
+#else
+		Serial.print((unsigned long) (elapsed * (F_CPU / 1000000.0) / count));
+		Serial.println(frames ? " cycles/frame" : " cycles/op");
+#endif
+	}
+};
+
+#endif
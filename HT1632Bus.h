@@ -0,0 +1,910 @@
+/*
+ * HT1632C Driver for Arduino by Luis M. Ruiz - stendall@gmail.com
+ * http://code.google.com/p/ht1632c-driver/
+ * 
+ * Licensed as : CC BY-NC-SA 3.0
+ * For more details see:
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * 
+ * This Code is based on the work "Holtech HT1632 Driver Class" from
+ * Steven Moughan.
+ * http://hackdev.com/sourcecode/ht1632-driver-arduino/
+ * 
+ * As stated by the license (CC BY_NC_SA 3.0) of the Steven code,
+ * and as this is a derived work, Steven it's not responsible, endorse
+ * or support this code in any implicit or explicit way. 
+ * Constructive criticism, ideas, corrections and patches are welcomed.
+ * Any help to make the code support a broader type of modules will be
+ * greatly appreciated.
+ */
+
+#ifndef HT1632BUS_H_h
+#define HT1632BUS_H_h
+
+/*
+ * Pin sets and transports. Included from HT1632C.h.
+ */
+
+/*
+ * Pin sets
+ * The low level part: how the bits get to the HT1632C (chipSelect,
+ * chipRelease and writeBits). chipSelect(HT1632_ALL_CHIPS) selects every
+ * chip at once. readBits clocks RD with DATA as an input, only if the RD
+ * pin is given: canRead() is false without it and readBits gives 0, no
+ * clocks on pin 0.
+ * HT1632Pins stores the pins in ram (pins choosed at runtime), so
+ * digitalWriteFast ends calling the slow digitalWrite.
+ * HT1632FastPins gets the pins as template parameters, they are known at
+ * compile time and digitalWriteFast folds every write to a single port
+ * instruction. Use it through the HT1632Fast template (see below).
+ * HT1632ShiftPins selects the chips through a shift register, for more than
+ * 4 chips (HT1632Shift template).
+ */
+class HT1632Pins {
+public:
+	HT1632Pins(byte data, byte wclock, byte chip0, byte chip1 = 0,
+			byte chip2 = 0, byte chip3 = 0, byte rclock = 0);
+
+	byte chips();							//Number of chips (modules) attached.
+	void chipSelect(byte chip);
+	void chipRelease(byte chip);
+	void writeBits(byte bits, byte mask);	//Send bits from mask (MSB first) to bit 0.
+	bool canRead();							//false if there's no RD pin.
+	byte readBits(byte mask);				//Read bits from mask (MSB first) to bit 0.
+
+private:
+	byte _DATA;
+	byte _WCLOCK;
+	byte _RCLOCK;
+	byte _CHIP0;
+	byte _CHIP1;
+	byte _CHIP2;
+	byte _CHIP3;
+	byte _NMODULES; //number of modules
+};
+
+//Chip select lines fixed at compile time. Shared by the compile time pin sets.
+template<byte CHIP0, byte CHIP1 = 0, byte CHIP2 = 0, byte CHIP3 = 0>
+class HT1632FastSelect {
+public:
+	HT1632FastSelect() {
+		pinMode(CHIP0, OUTPUT);
+		digitalWriteFast(CHIP0, HIGH);
+		if (CHIP1) {
+			pinMode(CHIP1, OUTPUT);
+			digitalWriteFast(CHIP1, HIGH);
+		}
+		if (CHIP2) {
+			pinMode(CHIP2, OUTPUT);
+			digitalWriteFast(CHIP2, HIGH);
+		}
+		if (CHIP3) {
+			pinMode(CHIP3, OUTPUT);
+			digitalWriteFast(CHIP3, HIGH);
+		}
+	}
+
+	byte chips() {
+		return (CHIP3 ? 4 : (CHIP2 ? 3 : (CHIP1 ? 2 : 1)));
+	}
+
+	inline void chipSelect(byte chip) {
+		switch (chip) {
+		case 0:
+			digitalWriteFast(CHIP0, LOW);
+			break;
+		case 1:
+			digitalWriteFast(CHIP1, LOW);
+			break;
+		case 2:
+			digitalWriteFast(CHIP2, LOW);
+			break;
+		case 3:
+			digitalWriteFast(CHIP3, LOW);
+			break;
+		case HT1632_ALL_CHIPS:
+			digitalWriteFast(CHIP0, LOW);
+			if (CHIP1) {
+				digitalWriteFast(CHIP1, LOW);
+			}
+			if (CHIP2) {
+				digitalWriteFast(CHIP2, LOW);
+			}
+			if (CHIP3) {
+				digitalWriteFast(CHIP3, LOW);
+			}
+			break;
+		}
+	}
+
+	inline void chipRelease(byte chip) {
+		switch (chip) {
+		case 0:
+			digitalWriteFast(CHIP0, HIGH);
+			break;
+		case 1:
+			digitalWriteFast(CHIP1, HIGH);
+			break;
+		case 2:
+			digitalWriteFast(CHIP2, HIGH);
+			break;
+		case 3:
+			digitalWriteFast(CHIP3, HIGH);
+			break;
+		case HT1632_ALL_CHIPS:
+			digitalWriteFast(CHIP0, HIGH);
+			if (CHIP1) {
+				digitalWriteFast(CHIP1, HIGH);
+			}
+			if (CHIP2) {
+				digitalWriteFast(CHIP2, HIGH);
+			}
+			if (CHIP3) {
+				digitalWriteFast(CHIP3, HIGH);
+			}
+			break;
+		}
+	}
+};
+
+/*
+ * Chip select lines through a 74HC164 cascade (Sure Electronics 3216
+ * boards), 1 output per chip, active low, chip 0 on the first output. CSDATA
+ * is the serial input of the register and CSCLOCK its clock, 2 pins for any
+ * number of chips. A chip is selected shifting a 0 (the token) to its output.
+ * chipRelease() moves the token one output forward (the next chip is
+ * selected but sees no WR clock), so a frame dump going chip by chip costs 1
+ * CSCLOCK per chip. Going back to a previous chip shifts a new token, after
+ * flushing the old one out of the chain.
+ * The outputs must follow the clock: there's no latch pulse, a 74HC595
+ * never updates them.
+ */
+template<byte CSDATA, byte CSCLOCK, byte CHIPS>
+class HT1632ShiftSelect {
+public:
+	HT1632ShiftSelect() {
+		pinMode(CSDATA, OUTPUT);
+		pinMode(CSCLOCK, OUTPUT);
+		digitalWriteFast(CSCLOCK, HIGH);
+		shift(HIGH, CHIPS); //All the chips released.
+		_TOKEN = CHIPS;
+	}
+
+	byte chips() {
+		return (CHIPS);
+	}
+
+	inline void chipSelect(byte chip) {
+		if (chip == HT1632_ALL_CHIPS) {
+			shift(LOW, CHIPS);
+		} else if (chip >= _TOKEN && _TOKEN < CHIPS) {
+			shift(HIGH, chip - _TOKEN);
+		} else {
+			//The old token must leave the chain while the new one gets to 'chip'.
+			if (CHIPS - _TOKEN > chip + 1)
+				shift(HIGH, CHIPS - _TOKEN - chip - 1);
+			shift(LOW, 1);
+			shift(HIGH, chip);
+		}
+		_TOKEN = chip;
+	}
+
+	inline void chipRelease(byte chip) {
+		if (chip == HT1632_ALL_CHIPS) {
+			shift(HIGH, CHIPS);
+			_TOKEN = CHIPS;
+		} else {
+			shift(HIGH, 1);
+			_TOKEN = chip + 1; //CHIPS: out of the chain.
+		}
+	}
+
+private:
+	byte _TOKEN; //Output with the 0, CHIPS if none.
+
+	inline void shift(byte bit, byte count) {
+		digitalWriteFast(CSDATA, bit);
+		while (count--) {
+			digitalWriteFast(CSCLOCK, LOW);
+			digitalWriteFast(CSCLOCK, HIGH);
+		}
+	}
+};
+
+//DATA, WR and RD fixed at compile time. Shared by the compile time pin sets.
+template<byte DATA, byte WCLOCK, byte RCLOCK = 0>
+class HT1632FastWire {
+public:
+	HT1632FastWire() {
+		pinMode(DATA, OUTPUT);
+		pinMode(WCLOCK, OUTPUT);
+		if (RCLOCK) {
+			pinMode(RCLOCK, OUTPUT);
+			digitalWriteFast(RCLOCK, HIGH);
+		}
+	}
+
+	inline void writeBits(byte bits, byte mask) {
+		while (mask) {
+			digitalWriteFast(WCLOCK, LOW);
+			if (bits & mask) {
+				digitalWriteFast(DATA, HIGH);
+			} else {
+				digitalWriteFast(DATA, LOW);
+			}
+			digitalWriteFast(WCLOCK, HIGH);
+			mask >>= 1;
+		}
+	}
+
+	bool canRead() {
+		return (RCLOCK != 0);
+	}
+
+	byte readBits(byte mask) {
+		byte bits = 0;
+
+		if (!RCLOCK)
+			return (0);
+		pinMode(DATA, INPUT);
+		while (mask) {
+			digitalWriteFast(RCLOCK, LOW);
+			HT1632_READ_DELAY();
+			if (digitalReadFast(DATA))
+				bits |= mask;
+			digitalWriteFast(RCLOCK, HIGH);
+			mask >>= 1;
+		}
+		pinMode(DATA, OUTPUT);
+		return (bits);
+	}
+};
+
+template<byte DATA, byte WCLOCK, byte CHIP0, byte CHIP1 = 0, byte CHIP2 = 0,
+		byte CHIP3 = 0, byte RCLOCK = 0>
+class HT1632FastPins: public HT1632FastSelect<CHIP0, CHIP1, CHIP2, CHIP3>,
+		public HT1632FastWire<DATA, WCLOCK, RCLOCK> {
+};
+
+//Any number of chips, selected through a shift register (see HT1632ShiftSelect).
+template<byte DATA, byte WCLOCK, byte CSDATA, byte CSCLOCK, byte CHIPS,
+		byte RCLOCK = 0>
+class HT1632ShiftPins: public HT1632ShiftSelect<CSDATA, CSCLOCK, CHIPS>,
+		public HT1632FastWire<DATA, WCLOCK, RCLOCK> {
+};
+
+#if defined(__AVR__) || defined(HT1632_HOST)
+/*
+ * One DATA pin per chip (lane), all in the same port, with a shared WR.
+ * 'Select' is the chip select pin set (HT1632FastSelect, HT1632ShiftSelect).
+ * writeBits() puts the same bit in every lane (only the selected chip takes
+ * it), writeLanes() sends a different byte to each lane with one port write
+ * per clock, for HT1632Driver::writeScreenLanes(). Lane n goes to chip n.
+ * WR may be in the lanes port, the port writes keep it low. No reads.
+ * Lanes on consecutive port bits in lane order (DATA0 the lowest) take the
+ * fast transpose of writeLanes(), any other order a bit by bit one.
+ */
+template<class Select, byte WCLOCK, byte DATA0, byte DATA1, byte DATA2 = 0,
+		byte DATA3 = 0, byte DATA4 = 0, byte DATA5 = 0, byte DATA6 = 0,
+		byte DATA7 = 0>
+class HT1632LanePins: public Select {
+public:
+	HT1632LanePins() {
+		const byte pins[8] = { DATA0, DATA1, DATA2, DATA3, DATA4, DATA5, DATA6, DATA7 };
+
+		pinMode(WCLOCK, OUTPUT);
+		_PORT = portOutputRegister(digitalPinToPort(DATA0));
+		_WCLOCK_MASK = portOutputRegister(digitalPinToPort(WCLOCK)) == _PORT ?
+				digitalPinToBitMask(WCLOCK) : 0;
+		_LANES = 0;
+		_CONSECUTIVE = true;
+		for (byte lane = 0; lane < 8; lane++) {
+			_MASK[lane] = 0;
+			if (lane < 2 || pins[lane]) {
+				pinMode(pins[lane], OUTPUT);
+				_MASK[lane] = digitalPinToBitMask(pins[lane]);
+				_LANES |= _MASK[lane];
+				if (_MASK[lane] != (byte) (_MASK[0] << lane))
+					_CONSECUTIVE = false;
+			}
+		}
+	}
+
+	inline void writeBits(byte bits, byte mask) {
+		byte low = *_PORT & ~(_LANES | _WCLOCK_MASK);
+
+		while (mask) {
+			digitalWriteFast(WCLOCK, LOW);
+			*_PORT = (bits & mask) ? (low | _LANES) : low;
+			digitalWriteFast(WCLOCK, HIGH);
+			mask >>= 1;
+		}
+	}
+
+	bool canRead() {
+		return (false);
+	}
+
+	byte readBits(byte /* mask */) {
+		return (0);
+	}
+
+	//8 clocks, data[n] (MSB first) on lane n. The bits are transposed to port bytes first.
+	inline void writeLanes(const byte * data, byte lanes) {
+		byte port[8];
+		byte low = *_PORT & ~(_LANES | _WCLOCK_MASK);
+
+		if (_CONSECUTIVE) {
+			//8x8 bit matrix transpose, lane n in row 7 - n: port[b] bit n is bit 7 - b of lane n.
+			for (byte row = 0; row < 8; row++)
+				port[row] = (7 - row < lanes) ? data[7 - row] : 0;
+			for (byte row = 0; row < 4; row++)
+				transposeStep<4, 0x0F>(port[row], port[row + 4]);
+			for (byte row = 0; row < 8; row += 4) {
+				transposeStep<2, 0x33>(port[row], port[row + 2]);
+				transposeStep<2, 0x33>(port[row + 1], port[row + 3]);
+			}
+			for (byte row = 0; row < 8; row += 2)
+				transposeStep<1, 0x55>(port[row], port[row + 1]);
+			for (byte b = 0; b < 8; b++)
+				port[b] = low | (byte) (port[b] * _MASK[0]); //<< the bit of DATA0, a mul on AVR.
+		} else {
+			memset((void *) port, low, sizeof(port));
+			for (byte lane = 0; lane < lanes; lane++) {
+				byte bits = data[lane];
+				for (byte b = 0; b < 8; b++) {
+					if (bits & 0x80)
+						port[b] |= _MASK[lane];
+					bits <<= 1;
+				}
+			}
+		}
+		for (byte b = 0; b < 8; b++) {
+			digitalWriteFast(WCLOCK, LOW);
+			*_PORT = port[b];
+			digitalWriteFast(WCLOCK, HIGH);
+		}
+	}
+
+private:
+	volatile uint8_t * _PORT;
+	byte _WCLOCK_MASK; //Port bit of WR if it's in the lanes port, the port writes clear it.
+	byte _LANES; //Port bits of all the lanes.
+	byte _MASK[8]; //Port bit of each lane.
+	bool _CONSECUTIVE; //Lane n in the port bit n + the bit of DATA0.
+
+	//Swaps the bits of 'a' in MASK with those of 'b' in MASK << SHIFT, a step of the transpose.
+	template<byte SHIFT, byte MASK>
+	static inline void transposeStep(byte & a, byte & b) {
+		byte t = (a ^ (b >> SHIFT)) & MASK;
+
+		a ^= t;
+		b ^= t << SHIFT;
+	}
+};
+#endif
+
+#ifdef HT1632_HOST
+/*
+ * Host side (PC) builds. There's no HT1632C, all the bits that would be sent
+ * to it are stored as a '0'/'1' string. Comparing the trace of two pin sets
+ * shows if they put the same bit stream in the wire.
+ */
+#define HT1632_TRACE_SIZE		16384
+class HT1632Trace {
+public:
+	static char log[HT1632_TRACE_SIZE + 1];
+	static unsigned int length;	//Bits stored in log.
+	static unsigned int bytes;	//Bytes sent by the (mock) SPI.
+
+	static void clear();
+	static void writeBits(byte bits, byte mask);
+};
+
+//Bitbang pin set that only writes the trace. Reference for the other pin sets.
+template<byte CHIPS = 1>
+class HT1632TracePins {
+public:
+	byte chips() {
+		return (CHIPS);
+	}
+	void chipSelect(byte /* chip */) {
+	}
+	void chipRelease(byte /* chip */) {
+	}
+	void writeBits(byte bits, byte mask) {
+		HT1632Trace::writeBits(bits, mask);
+	}
+	bool canRead() {
+		return (false);
+	}
+	byte readBits(byte /* mask */) {
+		return (0);
+	}
+};
+#endif
+
+#if defined(__AVR__) || defined(HT1632_HOST)
+//SPI clock, same values as SPI_CLOCK_DIVx of SPI.h
+#define HT1632_SPI_DIV2			0x04
+#define HT1632_SPI_DIV4			0x00
+#define HT1632_SPI_DIV8			0x05
+#define HT1632_SPI_DIV16		0x01
+#define HT1632_SPI_DIV32		0x06
+#define HT1632_SPI_DIV64		0x02
+
+#ifdef HT1632_HOST
+//Mock of the SPI peripheral, writes the trace.
+struct HT1632SpiPort {
+	static void begin(byte /* divider */) {
+		HT1632Trace::clear();
+	}
+	static inline void transfer(byte data) {
+		HT1632Trace::writeBits(data, 1 << 7);
+		HT1632Trace::bytes++;
+	}
+	static inline void writeBits(byte bits, byte mask) {
+		HT1632Trace::writeBits(bits, mask);
+	}
+	template<byte RCLOCK>
+	static byte readBits(byte /* mask */) {
+		return (0);
+	}
+	static inline void end() {
+	}
+};
+#else
+struct HT1632SpiPort {
+	static void begin(byte divider) {
+		pinMode(SS, OUTPUT); //SS must be an output to stay in master mode.
+		pinMode(MOSI, OUTPUT);
+		pinMode(SCK, OUTPUT);
+		digitalWrite(SCK, HIGH);
+		//Mode 3: WR idles high and the HT1632C reads DATA at the rising edge.
+		SPCR = _BV(MSTR) | _BV(CPOL) | _BV(CPHA) | (divider & 0x03);
+		if (divider & 0x04)
+			SPSR |= _BV(SPI2X);
+		else
+			SPSR &= ~_BV(SPI2X);
+	}
+	static inline void transfer(byte data) {
+		SPCR |= _BV(SPE);
+		SPDR = data;
+		while (!(SPSR & _BV(SPIF)))
+			;
+	}
+	//MOSI and SCK back to PORT (SCK high), for other pin sets on the same pins.
+	static inline void end() {
+		SPCR &= ~_BV(SPE);
+	}
+	//Bitbangs MOSI/SCK. With the SPI disabled the pins go back to PORT, SCK high.
+	static inline void writeBits(byte bits, byte mask) {
+		SPCR &= ~_BV(SPE);
+		while (mask) {
+			digitalWriteFast(SCK, LOW);
+			if (bits & mask) {
+				digitalWriteFast(MOSI, HIGH);
+			} else {
+				digitalWriteFast(MOSI, LOW);
+			}
+			digitalWriteFast(SCK, HIGH);
+			mask >>= 1;
+		}
+	}
+	//Reads MOSI clocking RD, with the SPI disabled.
+	template<byte RCLOCK>
+	static byte readBits(byte mask) {
+		byte bits = 0;
+
+		if (!RCLOCK)
+			return (0);
+		SPCR &= ~_BV(SPE);
+		pinMode(MOSI, INPUT);
+		while (mask) {
+			digitalWriteFast(RCLOCK, LOW);
+			HT1632_READ_DELAY();
+			if (digitalReadFast(MOSI))
+				bits |= mask;
+			digitalWriteFast(RCLOCK, HIGH);
+			mask >>= 1;
+		}
+		pinMode(MOSI, OUTPUT);
+		return (bits);
+	}
+};
+#endif
+
+/*
+ * Hardware SPI pin set: DATA on MOSI and WR on SCK. The SPI only sends whole
+ * bytes, so the 8 bit fields (two nibbles in writeScreen, the command byte)
+ * go through it and the odd sized ones (3 bit ids, 7 bit addresses, single
+ * nibbles) are bitbanged on the same pins.
+ */
+template<byte CHIP0, byte CHIP1 = 0, byte CHIP2 = 0, byte CHIP3 = 0,
+		byte DIVIDER = HT1632_SPI_DIV8, byte RCLOCK = 0>
+class HT1632SpiPins: public HT1632FastSelect<CHIP0, CHIP1, CHIP2, CHIP3> {
+public:
+	HT1632SpiPins() {
+		HT1632SpiPort::begin(DIVIDER);
+		if (RCLOCK) {
+			pinMode(RCLOCK, OUTPUT);
+			digitalWriteFast(RCLOCK, HIGH);
+		}
+	}
+
+	//The SPI is disabled at the end of every transaction.
+	inline void chipRelease(byte chip) {
+		HT1632SpiPort::end();
+		HT1632FastSelect<CHIP0, CHIP1, CHIP2, CHIP3>::chipRelease(chip);
+	}
+
+	bool canRead() {
+		return (RCLOCK != 0);
+	}
+
+	byte readBits(byte mask) {
+		return (HT1632SpiPort::readBits<RCLOCK>(mask));
+	}
+
+	inline void writeBits(byte bits, byte mask) {
+		if (mask == 1 << 7)
+			HT1632SpiPort::transfer(bits);
+		else
+			HT1632SpiPort::writeBits(bits, mask);
+	}
+};
+#endif
+
+/*
+ * Transports
+ * HT1632Driver talks with the chips through a transport, a class with:
+ *   byte chips();
+ *   void chipSelect(byte chip);
+ *   void chipRelease(byte chip);
+ *   void sendCommand(byte command, byte chip);
+ *   void sendCommands(const byte * commands, byte count, byte chip);
+ *   void writeData(byte address, byte data, byte chip);
+ *   void writeSuccesiveStart(byte address, byte chip);
+ *   void writeSuccesive(byte data);		//1 nibble
+ *   void writeSuccesiveByte(byte data);	//2 nibbles, high first
+ *   void writeSuccesiveStop(byte chip);
+ *   bool canRead();		//false: no RD line, the reads give 0.
+ *   byte readData(byte address, byte chip);
+ *   void readSuccesiveStart(byte address, byte chip);
+ *   byte readSuccesive();
+ *   void readSuccesiveStop(byte chip);
+ *   byte readModifyWrite(byte address, byte mask, byte data, byte chip);
+ * 'chip' can be HT1632_ALL_CHIPS in all of them, except in the reads.
+ * With HT1632_STATS they also have a HT1632Stats 'stats' with the bits and
+ * selects counted.
+ * Transports with a DATA line per chip add
+ *   void writeSuccesiveLanes(const byte * data, byte lanes);	//data[n] to chip n
+ * used between writeSuccesiveStart/Stop(HT1632_ALL_CHIPS) by writeScreenLanes().
+ * The calls are resolved at compile time, there are no virtual functions.
+ * HT1632Bus<Pins> clocks the HT1632C protocol through any pin set
+ * (HT1632Pins, HT1632FastPins, HT1632ShiftPins, HT1632SpiPins, HT1632TracePins).
+ * HT1632MemoryBus<CHIPS> has no hardware at all, see below.
+ */
+template<class Pins>
+class HT1632Bus: public Pins {
+public:
+#ifdef HT1632_STATS
+	HT1632Stats stats;
+#endif
+
+	template<typename ... Args>
+	HT1632Bus(Args ... args) :
+			Pins(args...) {
+#ifdef HT1632_STATS
+		memset((void *) &stats, 0, sizeof(stats));
+#endif
+	}
+
+	//The pin set calls, counted with HT1632_STATS. 'mask' is 1 << (bits - 1).
+	inline void chipSelect(byte chip) {
+		HT1632_COUNT(stats.selects, 1);
+		Pins::chipSelect(chip);
+	}
+
+	inline void writeBits(byte bits, byte mask) {
+		HT1632_COUNT(stats.bits, __builtin_ctz(mask) + 1);
+		Pins::writeBits(bits, mask);
+	}
+
+	inline byte readBits(byte mask) {
+		HT1632_COUNT(stats.bits, __builtin_ctz(mask) + 1);
+		return (Pins::readBits(mask));
+	}
+
+	void sendCommand(byte command, byte chip) {
+		this->chipSelect(chip);
+		this->writeBits(HT1632_CTL_COMMAND, 1 << 2); //3 bit command id
+		this->writeBits(command, 1 << 7); //8 bit command
+		this->writeBits(0, 1); //There's one extra bit in commands that dont matter...
+		this->chipRelease(chip);
+	}
+
+	//Several commands in one transaction, the 100 id is sent only once.
+	void sendCommands(const byte * commands, byte count, byte chip) {
+		this->chipSelect(chip);
+		this->writeBits(HT1632_CTL_COMMAND, 1 << 2); //3 bit command id
+		while (count--) {
+			this->writeBits(*commands++, 1 << 7); //8 bit command
+			this->writeBits(0, 1); //extra bit
+		}
+		this->chipRelease(chip);
+	}
+
+	void writeData(byte address, byte data, byte chip) {
+		this->chipSelect(chip); //Select the chip...
+		//Send the WRITE command...
+		this->writeBits(HT1632_CTL_WRITE, 1 << 2);  //1<<2   3 bit command
+		//Send the Address...
+		this->writeBits(address, 1 << 6);   //1<<6  7 bit address
+		//Send the data...
+		this->writeBits(data, 1 << 3);    //1<<3    4 bit data
+		this->chipRelease(chip);    //Release the chip...
+	}
+
+	void writeSuccesiveStart(byte address, byte chip) {
+		this->chipSelect(chip); //Select the chip...
+		//Send the WRITE command...
+		this->writeBits(HT1632_CTL_WRITE, 1 << 2);  //1<<2   3 bit command
+		//Send the Address...
+		this->writeBits(address, 1 << 6);   //1<<6  7 bit address
+	}
+
+	inline void writeSuccesive(byte data) {
+		this->writeBits(data, 1 << 3);    //1<<3    4 bit data
+	}
+
+	inline void writeSuccesiveByte(byte data) {
+		this->writeBits(data, 1 << 7);    //1<<7    2 nibbles at once
+	}
+
+	//Only with HT1632LanePins.
+	inline void writeSuccesiveLanes(const byte * data, byte lanes) {
+		HT1632_COUNT(stats.bits, 8);
+		this->writeLanes(data, lanes);    //2 nibbles in each lane
+	}
+
+	void writeSuccesiveStop(byte chip) {
+		this->chipRelease(chip);    //Release the chip...
+	}
+
+	byte readData(byte address, byte chip) {
+		byte data;
+
+		readSuccesiveStart(address, chip);
+		data = readSuccesive();
+		readSuccesiveStop(chip);
+		return (data);
+	}
+
+	void readSuccesiveStart(byte address, byte chip) {
+		this->chipSelect(chip);
+		this->writeBits(HT1632_CTL_READ, 1 << 2);  //1<<2   3 bit command
+		this->writeBits(address, 1 << 6);   //1<<6  7 bit address
+	}
+
+	inline byte readSuccesive() {
+		return (this->readBits(1 << 3)); //RD clocks out 1 nibble, address increments.
+	}
+
+	void readSuccesiveStop(byte chip) {
+		this->chipRelease(chip);
+	}
+
+	/*
+	 * READ-MODIFY-WRITE shares the id with WRITE, the chip knows it by the RD
+	 * clocks after the address. The nibble becomes (old & ~mask) | (data & mask).
+	 * Returns the old nibble.
+	 */
+	byte readModifyWrite(byte address, byte mask, byte data, byte chip) {
+		byte old;
+
+		this->chipSelect(chip);
+		this->writeBits(HT1632_CTL_RMW, 1 << 2);  //1<<2   3 bit command
+		this->writeBits(address, 1 << 6);   //1<<6  7 bit address
+		old = this->readBits(1 << 3);
+		this->writeBits((old & ~mask) | (data & mask), 1 << 3);
+		this->chipRelease(chip);
+		return (old);
+	}
+};
+
+//What a HT1632C has inside: RAM and the state set by the commands.
+struct HT1632ChipState {
+	byte ram[HT1632_RAM_SIZE];	//1 nibble per address.
+	byte com;		//Last HT1632_CMD_COMxx
+	byte pwm;		//0..15
+	bool system;	//SYSEN
+	bool led;		//LEDON
+	bool blink;
+	bool master;	//RCMASTER/EXTCLK or SLAVEMODE
+
+	//What a command (HT1632_CMD_xx, HT1632_PWM_CONTROL | pwm) changes.
+	void execute(byte command) {
+		if ((command & 0xF0) == HT1632_PWM_CONTROL)
+			pwm = command & 0xF;
+		else if ((command & 0xF0) == HT1632_CMD_COM00)
+			com = command & 0xFC;
+		else {
+			switch (command) {
+			case HT1632_CMD_SYSDIS:
+				system = false;
+				led = false;
+				break;
+			case HT1632_CMD_SYSEN:
+				system = true;
+				break;
+			case HT1632_CMD_LEDOFF:
+				led = false;
+				break;
+			case HT1632_CMD_LEDON:
+				led = true;
+				break;
+			case HT1632_CMD_BLINKOFF:
+				blink = false;
+				break;
+			case HT1632_CMD_BLINKON:
+				blink = true;
+				break;
+			case HT1632_CMD_SLAVEMODE:
+				master = false;
+				break;
+			case HT1632_CMD_RCMASTER:
+			case HT1632_CMD_EXTCLK:
+				master = true;
+				break;
+			}
+		}
+	}
+};
+
+/*
+ * Transport without hardware. Every chip is a HT1632ChipState in ram, so the
+ * frames can be checked (and timed) in any machine, or without display.
+ */
+template<byte CHIPS = 1>
+class HT1632MemoryBus {
+public:
+	HT1632ChipState state[CHIPS];
+	unsigned int commands;	//Command transactions.
+	unsigned int writes;	//Nibbles written.
+#ifdef HT1632_STATS
+	HT1632Stats stats;		//What HT1632Bus would clock.
+#endif
+
+	HT1632MemoryBus() {
+		memset((void *) state, 0, sizeof(state));
+#ifdef HT1632_STATS
+		memset((void *) &stats, 0, sizeof(stats));
+#endif
+		commands = 0;
+		writes = 0;
+		_CHIP = 0;
+		_ADDRESS = 0;
+	}
+
+	byte chips() {
+		return (CHIPS);
+	}
+
+	void chipSelect(byte chip) {
+	}
+
+	void chipRelease(byte chip) {
+	}
+
+	void sendCommand(byte command, byte chip) {
+		commands++;
+		HT1632_COUNT(stats.selects, 1);
+		HT1632_COUNT(stats.bits, 3 + 9);
+		apply(command, chip);
+	}
+
+	void sendCommands(const byte * list, byte count, byte chip) {
+		commands++;
+		HT1632_COUNT(stats.selects, 1);
+		HT1632_COUNT(stats.bits, 3 + 9 * count);
+		while (count--)
+			apply(*list++, chip);
+	}
+
+	void writeData(byte address, byte data, byte chip) {
+		writeSuccesiveStart(address, chip);
+		writeSuccesive(data);
+	}
+
+	void writeSuccesiveStart(byte address, byte chip) {
+		HT1632_COUNT(stats.selects, 1);
+		HT1632_COUNT(stats.bits, 3 + 7);
+		_CHIP = chip;
+		_ADDRESS = address & 0x7F;
+	}
+
+	void writeSuccesive(byte data) {
+		if (_ADDRESS < HT1632_RAM_SIZE) {
+			if (_CHIP == HT1632_ALL_CHIPS) {
+				for (byte chip = 0; chip < CHIPS; chip++)
+					state[chip].ram[_ADDRESS] = data & 0xF;
+			} else
+				state[_CHIP].ram[_ADDRESS] = data & 0xF;
+		}
+		_ADDRESS = (_ADDRESS + 1) & 0x7F; //7 bit address counter
+		writes++;
+		HT1632_COUNT(stats.bits, 4);
+	}
+
+	void writeSuccesiveByte(byte data) {
+		writeSuccesive(data >> 4);
+		writeSuccesive(data);
+	}
+
+	void writeSuccesiveLanes(const byte * data, byte lanes) {
+		if (_ADDRESS < HT1632_RAM_SIZE) {
+			for (byte chip = 0; chip < lanes && chip < CHIPS; chip++) {
+				state[chip].ram[_ADDRESS] = data[chip] >> 4;
+				state[chip].ram[_ADDRESS + 1] = data[chip] & 0xF;
+			}
+		}
+		_ADDRESS = (_ADDRESS + 2) & 0x7F;
+		writes += 2;
+		HT1632_COUNT(stats.bits, 8);
+	}
+
+	void writeSuccesiveStop(byte /* chip */) {
+	}
+
+	bool canRead() {
+		return (true);
+	}
+
+	byte readData(byte address, byte chip) {
+		readSuccesiveStart(address, chip);
+		return (readSuccesive());
+	}
+
+	void readSuccesiveStart(byte address, byte chip) {
+		writeSuccesiveStart(address, chip);
+	}
+
+	byte readSuccesive() {
+		byte data = 0;
+
+		if (_ADDRESS < HT1632_RAM_SIZE)
+			data = state[_CHIP].ram[_ADDRESS];
+		_ADDRESS = (_ADDRESS + 1) & 0x7F;
+		HT1632_COUNT(stats.bits, 4);
+		return (data);
+	}
+
+	void readSuccesiveStop(byte /* chip */) {
+	}
+
+	//One transaction, the address is the same for the read and the write.
+	byte readModifyWrite(byte address, byte mask, byte data, byte chip) {
+		byte old;
+
+		readSuccesiveStart(address, chip);
+		old = readSuccesive();
+		_ADDRESS = address & 0x7F;
+		writeSuccesive((old & ~mask) | (data & mask));
+		return (old);
+	}
+
+private:
+	byte _CHIP;
+	byte _ADDRESS;
+
+	void apply(byte command, byte chip) {
+		if (chip == HT1632_ALL_CHIPS) {
+			for (chip = 0; chip < CHIPS; chip++)
+				state[chip].execute(command);
+		} else
+			state[chip].execute(command);
+	}
+};
+
+#endif
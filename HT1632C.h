@@ -42,10 +42,41 @@
 #define FONT_4x6
 #include "font.h"
 
+//Wait for the HT1632C data output after the RD falling edge.
+#define HT1632_READ_DELAY()		delayMicroseconds(1)
+
+//Uncomment to count what the library does (getStats()): bits clocked, chip
+//selects, frames, pixels drawn, frame time and how long writeScreen() keeps
+//the interrupts disabled (getCriticalMax()). It costs a few counters and a
+//timer read per screen byte sent. Commented out, nothing.
+//#define HT1632_STATS
+#ifdef HT1632_MEASURE_CLI
+#define HT1632_STATS	//Former name, the critical section time is in the stats now.
+#endif
+
+//Clock of HT1632_STATS. micros() stops with the interrupts off (the timer 0
+//overflows are lost after 1 ms), TCNT0 doesn't: the driver reads it at every
+//screen byte and sums the ticks (F_CPU / 64, the Arduino core prescaler).
+//Right while a byte takes less than 256 ticks, 1 ms at 16 MHz.
+#if defined(__AVR__) && defined(TCNT0)
+#define HT1632_TIMER()				TCNT0
+#define HT1632_TIMER_US(ticks)		((ticks) * 64UL / (F_CPU / 1000000UL))
+#else
+#define HT1632_TIMER()				((byte) micros())
+#define HT1632_TIMER_US(ticks)		(ticks)
+#endif
+
+//Uncomment for screens over 255 pixels wide or tall, or buffers over 255
+//bytes: sizes, buffer offsets and mapping tables become 16 bit. Without it
+//the pixel math stays in bytes, the fastest on 8 bit MCUs. It must be the
+//same for the whole library (the .cpp builds HT1632Canvas).
+//#define HT1632_WIDE
+
 //Data Mode
 #define HT1632_CTL_COMMAND      0x04    //Preceeds all _COMMANDS_ to the system
 #define HT1632_CTL_WRITE        0x05    //Write data to the RAM
 #define HT1632_CTL_READ         0x06    //Read data from the RAM
+#define HT1632_CTL_RMW          0x05    //Read-modify-write the RAM (same id as write)
 //Command Mode
 #define HT1632_CMD_SYSDIS       0x00    //Turn off system oscillator and LED duty cycle generator
 #define HT1632_CMD_SYSEN        0x01    //Turn on system oscillator
@@ -57,7 +88,7 @@
 #define HT1632_CMD_RCMASTER     0x18    //Set master mode anc clock source from on-chip RC oscillator, the system clock output to OSC pin and synchronous signal output SYN pin
 #define HT1632_CMD_EXTCLK       0x1C    //System clock source, external
 #define HT1632_CMD_COM00        0x20    //N-MOS open drain output and 8 COM option
-#define HT1632_CMD_COM01        0x24    //N-MOS open drain output and 8 COM option
+#define HT1632_CMD_COM01        0x24    //N-MOS open drain output and 16 COM option
 #define HT1632_CMD_COM10        0x28    //P-MOS open drain output and 8 COM option
 #define HT1632_CMD_COM11        0x2C    //P-MOS open drain output and 16 COM option
 //Command Mode - PWM Settings
@@ -78,80 +109,864 @@
 #define HT1632_CMD_PWM14        0xAD    //PWM 14/16 Duty
 #define HT1632_CMD_PWM15        0xAE    //PWM 15/16 Duty
 #define HT1632_CMD_PWM16        0xAF    //PWM 16/16 Duty
-// TODO Support more modules sizes
-#define HT1632_MODULE_8X32		0x00    //Each Module have 8x32 pixels wide.
-#define HT1632_MODULE_16X24		0x01    //Each Module have 16x24 pixels wide.
+//Modules (see HT1632Geometry in HT1632Canvas.h). Low nibble: the chip matrix,
+//high nibble: how the module is mounted (HT1632_ROTATE_xx).
+#define HT1632_MODULE_8X32		0x00    //Each Module have 8x32 pixels wide. 32 ROW x 8 COM.
+#define HT1632_MODULE_16X24		0x01    //Each Module have 16x24 pixels wide. 24 ROW x 16 COM.
+#define HT1632_MODULE_MASK		0x0F
+//Module rotation, clockwise. 90 and 270 swap width and height.
+#define HT1632_ROTATE_0			0x00
+#define HT1632_ROTATE_90		0x10
+#define HT1632_ROTATE_180		0x20
+#define HT1632_ROTATE_270		0x30
+#define HT1632_ROTATE_MASK		0x30
+#define HT1632_MODULE_24X16		(HT1632_MODULE_16X24 | HT1632_ROTATE_90)	//16x24 standing: 16 wide, 24 tall.
+#define HT1632_MODULE_32X8		(HT1632_MODULE_8X32 | HT1632_ROTATE_90)		//8x32 standing: 8 wide, 32 tall.
+
+#define HT1632_COM_MODULE		0xFF	//As init() mode: the COM option of the module.
+//Screen buffer layout (init). Rows: each byte is 8 pixels of a row, rows one
+//after the other (setByte() friendly). Wire: the bytes in HT1632C RAM address
+//order, column group by column group, so writeScreen() sends the buffer as
+//it is. drawPixel() costs the same in both.
+#define HT1632_LAYOUT_ROWS		0x00
+#define HT1632_LAYOUT_WIRE		0x01
+//With more than one module (one chip each) they are stacked vertically:
+//8x32 -> 32 x (8 * modules) pixels, 16x24 -> 24 x (16 * modules) pixels.
+
+#define HT1632_ALL_CHIPS		0xFF	//As 'chip': all the chips at once (broadcast), one transaction for the whole chain.
+
+#define HT1632_ASYNC_CHUNK		8		//Screen bytes (16 nibbles) sent by each writeScreenStep().
+
+//Triple buffer state: buffer indexes front | pending << 2 | back << 4.
+#define HT1632_TRIPLE_START		0x24	//Front 0, pending 1, back 2.
+#define HT1632_TRIPLE_FRESH		0x80	//The pending buffer has a frame not sent yet.
+
+#define HT1632_RAM_SIZE			96		//Nibbles of RAM in each HT1632C (24 ROW x 16 COM).
+
+//Counters of HT1632_STATS, see HT1632Driver::getStats().
+struct HT1632Stats {
+	unsigned long bits;		//Clocks on WR (and RD): ids, addresses, commands and data.
+	unsigned long selects;	//Chip select transactions.
+	unsigned long frames;	//Frames sent: writeScreen(), asynchronous, lanes and gray planes.
+	unsigned long pixels;	//Pixels drawn inside the screen.
+	unsigned long frameTime;	//us of the last writeScreen() or writeScreenLanes(), on the HT1632_TIMER() clock.
+	unsigned int criticalMax;	//Longest time (us) with the interrupts disabled by writeScreen(), 65535 max.
+};
+
+#ifdef HT1632_STATS
+#define HT1632_COUNT(counter, n)	((counter) += (n))
+#else
+#define HT1632_COUNT(counter, n)
+#endif
+
+#include "HT1632Bus.h"
+#include "HT1632Canvas.h"
 
-class HT1632 {
+typedef void (*HT1632Callback)();
+
+//Counters of the fixed rate refresh (HT1632Driver::beginRefresh()).
+struct HT1632RefreshStats {
+	unsigned long frames;	//Frames sent.
+	unsigned int missed;	//Frame starts with the previous frame still on the wire.
+	unsigned int dropped;	//Frames replaced by a newer one before being sent.
+	unsigned int repeated;	//Frame starts without a new frame, the screen stays.
+	unsigned long frameTime;	//us between the last two frames sent.
+};
+
+/*
+ * The driver itself. 'Bus' is the transport used to talk with the HT1632C
+ * (see HT1632Bus.h), usually HT1632Bus<pin set>. 'Storage' holds the screen
+ * buffers (see HT1632Canvas.h), sized at runtime by default.
+ */
+template<class Bus, class Storage = HT1632HeapStorage>
+class HT1632Driver: public HT1632CanvasBase<Storage> {
 public:
-	HT1632(byte data, byte wclock, byte chip0, byte chip1 = NULL, byte chip2 =
-			NULL, byte chip3 = NULL, byte rclock = NULL);
-	void init(byte chip = 0, byte mode = HT1632_CMD_COM00, byte module =
-			HT1632_MODULE_8X32);
+	HT1632Driver() {
+		_ASYNC_BUSY = false;
+		_GRAY_PLANE = 0;
+		_GRAY_TICKS = 0;
+		_REFRESH_TICKS = 0;
+		_REFRESH_READY = NULL;
+		_REFRESH_FRONT = NULL;
+		_TRIPLE = 0;
+		memset((void *) &_REFRESH_STATS, 0, sizeof(_REFRESH_STATS));
+		_CLI_CHUNK = 0;
+#ifdef HT1632_STATS
+		_TICKS = 0;
+		_TICK_LAST = 0;
+#endif
+	}
+	HT1632Driver(byte data, byte wclock, byte chip0, byte chip1 = 0,
+			byte chip2 = 0, byte chip3 = 0, byte rclock = 0) :
+			_BUS(data, wclock, chip0, chip1, chip2, chip3, rclock) {
+		_ASYNC_BUSY = false;
+		_GRAY_PLANE = 0;
+		_GRAY_TICKS = 0;
+		_REFRESH_TICKS = 0;
+		_REFRESH_READY = NULL;
+		_REFRESH_FRONT = NULL;
+		_TRIPLE = 0;
+		memset((void *) &_REFRESH_STATS, 0, sizeof(_REFRESH_STATS));
+		_CLI_CHUNK = 0;
+#ifdef HT1632_STATS
+		_TICKS = 0;
+		_TICK_LAST = 0;
+#endif
+	}
+	/*
+	 * Sets up and clears all the chips at once. 'chip' does nothing, it's only
+	 * kept so that old sketches still compile. false if there's no memory for
+	 * the screen buffers or too many modules (more than 255 bytes need
+	 * HT1632_WIDE): the screen is 0x0 then.
+	 */
+	bool init(byte chip = 0, byte mode = HT1632_COM_MODULE, byte module =
+			HT1632_MODULE_8X32, byte layout = HT1632_LAYOUT_ROWS);
 
 
+	//chip = HT1632_ALL_CHIPS changes all of them in one transaction (synchronized fades/blinks).
 	void setBrightness(byte pwm, byte chip = 0);// Low level command to change the PWM dutycycle in HT1632
 	void blinkMode(bool blink = false, byte chip = 0);// Low level command to change the blink attribute in the HT1632
-	void chipClear(byte chip = 0); 			// Low level command to clear HT1632 internal buffer
+	void sendCommand(byte command, byte chip = HT1632_ALL_CHIPS);// Any HT1632_CMD_xxx, to all the chips by default.
+	void sendCommands(const byte * commands, byte count, byte chip = HT1632_ALL_CHIPS);// Several commands in one transaction.
+	void chipClear(byte chip = 0); 			// Low level command to clear HT1632 internal buffer (HT1632_ALL_CHIPS: all)
 	void writeScreen();						//Dumps the whole screen buffer (Arduino memory)  (1 module or more) to the buffer of HT1632's used.
 
 	/*
-	 * All x,y screen coordinates can be negatives and therefore use it to make scroll/displace effects
-	 * All following functions draw to Screen buffer (active)
-	 * -->
+	 * Asynchronous writeScreen. beginWriteScreen() takes the active buffer
+	 * and returns at once, the frame is sent by writeScreenStep() called from
+	 * an interrupt (timer, ...), HT1632_ASYNC_CHUNK screen bytes each call.
+	 * Meanwhile draw on the other buffer (swapBuffers()) and don't use the
+	 * HT1632C functions (writeScreen waits for the transfer to end).
+	 * 'done' is called from the interrupt when the whole frame is sent.
 	 */
+	bool beginWriteScreen(HT1632Callback done = NULL);	//false if a transfer is running.
+	bool writeScreenStep(byte count = HT1632_ASYNC_CHUNK);	//Call from the ISR. false when there's nothing left.
+	bool isBusy();							//true while an asynchronous transfer is running.
 
-	void clearScreen(); 					//Clear memory of active buffer. Fill with zeros
-	void fillScreen();						//Fill memory of active buffer. Fill with 0xFF
-	void setByte(int address, byte d);		//Write a byte 'd' at the memory 'address' of the active screen buffer
-	void drawPixel(int x, int y, byte color = 1); //Draws a pixel with the choosed color.
-	byte getPixel(int x, int y);			//Return the pixel value at x,y position in screen buffer.
-	void setPixel(int x, int y);			//Same that DrawPixel but always lit pixel.
-	void clearPixel(int x, int y);			//Same that DrawPixel but always dark pixel.
-	void drawLine(int x1, int y1, int x2, int y2, byte color = 1);
-	void drawRect(int x, int y, int w, int h, byte color = 1);
-	void fillRect(int x, int y, int w, int h, byte color = 1);
-	void drawCircle(int x0, int y0, byte r, byte color = 1);
-	void fillCircle(int x0, int y0, byte r, byte color = 1);
-	void drawChar(int x, int y, char c, byte color = 1); // Puts character 'c' at x,y position.
-	void drawString(int x, int y, const char* str, byte color); // Write string 'str' at x,y position.
-	void animateDown();						//Move down 1 pixel at time the whole screen buffer content.
 	/*
-	 * <--
+	 * Fixed rate refresh on top of the asynchronous writeScreen. Call
+	 * refreshStep() from a timer interrupt: a frame starts every 'ticks'
+	 * calls and every call sends HT1632_ASYNC_CHUNK screen bytes. Draw on the
+	 * active buffer and call frameDone() when the frame is complete, it's
+	 * sent at the next frame start and drawing goes on in the other buffer
+	 * (frameDone() waits while that one is still on the wire). The animation
+	 * speed doesn't depend on loop() anymore.
+	 *
+	 * With 'triple' the screen buffers 0, 1 and 2 are front (on the chips),
+	 * pending (last complete frame) and back (drawn, the active buffer).
+	 * present() swaps back and pending and never waits: at a frame start the
+	 * refresh takes pending as the new front if it's fresh, so a frame is
+	 * never sent half drawn. The handoff is a single byte of indexes. Don't
+	 * use setActiveBuffer(), swapBuffers() or gray planes meanwhile.
 	 */
-	void setActiveBuffer(byte b);//Change the active buffer where draw functions operate.
-	void swapBuffers();			//Exchange Active (front buffer on DumpScreen) and back buffer. Double buffer.
-	byte getActiveBuffer();		//Returns the number of the current buffer;
+	bool beginRefresh(byte ticks, bool triple = false);	//false if there's no third buffer.
+	void endRefresh();						//Stops at the end of the frame being sent.
+	void refreshStep();						//Call from the ISR.
+	void frameDone();						//The active buffer is the next frame.
+	void present();							//Same with triple buffer, without waiting.
+	HT1632RefreshStats getRefreshStats();
+	void resetRefreshStats();
 
+	/*
+	 * With a DATA pin per chip (HT1632LanePins) all the modules are sent at
+	 * the same time, byte n of every module in the same 8 clocks. Always the
+	 * whole screen, up to 8 modules. The clocks are shared but each byte is
+	 * still transposed to the port, so it's not N times faster: see
+	 * HT1632Bench::runLanes() (Benchmark example, LANES_WIRING).
+	 */
+	void writeScreenLanes();
+
+	/*
+	 * writeScreen() disables the interrupts while sending. By default for the
+	 * whole frame, with setCriticalSection(bytes) they are enabled again every
+	 * 'bytes' screen bytes (8 clocks each, about 5us with HT1632Fast). The
+	 * chip stays selected, so the burst isn't broken. 0 = whole frame.
+	 */
+	void setCriticalSection(byte bytes);
+
+#ifdef HT1632_STATS
+	unsigned int getCriticalMax();			//Longest time (us) writeScreen() had the interrupts disabled.
+	void resetCriticalMax();
+	HT1632Stats getStats();					//Driver, drawing and transport counters.
+	void resetStats();
+#endif
+
+	/*
+	 * Grayscale refresh (see setGrayBits()). Call writeGrayStep() from a timer
+	 * interrupt at a fixed rate: plane k is sent and kept for 2^k calls, a
+	 * whole cycle is 2^bits - 1 calls (2kHz and 3 bits: 285Hz). Each plane is
+	 * a whole frame sent inside the interrupt, so it needs a fast transport
+	 * (HT1632Fast, HT1632Spi). Don't use writeScreen() meanwhile.
+	 */
+	void writeGrayStep();
+
+	/*
+	 * Reading the HT1632C RAM, needs the RD pin (rclock) wired. Not for
+	 * HT1632_ALL_CHIPS. Without it readData() gives 0, verifyScreen() false
+	 * and drawPixelDirect() writes the nibble from the last buffer sent.
+	 */
+	byte readData(byte address, byte chip = 0);	//1 nibble of the chip RAM.
+	bool verifyScreen();					//true if the chips have what the last writeScreen() sent.
+	void drawPixelDirect(int x, int y, byte color = 1);	//Read-modify-write of the pixel in the chip, no writeScreen() needed.
+
+	Bus & bus();							//The transport, to inspect it (HT1632MemoryBus) or share it.
 
 private:
-	byte _DATA;
-	byte _WCLOCK;
-	byte _RCLOCK;
-	byte _CHIP0;
-	byte _CHIP1;
-	byte _CHIP2;
-	byte _CHIP3;
-	byte _NMODULES; //number of modules
-	byte _MODULE; //model 32x8 or 24x16
-	byte _WIDTH; //Sum of all modules Width.
-	byte _HEIGHT; //Sum of all modules Height.
-	byte _SCREENSIZE; //Bytes, not pixels
-	byte * _SCREEN_BUFFER1;
-	byte * _SCREEN_BUFFER2;
-	byte _BUFFER_ACTIVE;
-	byte _BUFFER_MALLOC;
-
-	void chipSelect(byte chip);
-	void chipRelease(byte chip);
-	void sendCommand(byte command, byte chip = 0);
-	void writeBits(byte bits, byte mask);
-	byte readData(byte address, byte chip);
-	void writeData(byte address, byte data, byte chip = 0);
-
-	void writeSuccesive(byte data);
-	void writeSuccesiveStart(byte address, byte chip = 0);
-	void writeSuccesiveStop(byte chip = 0);
+	typedef HT1632CanvasBase<Storage> Canvas;
+	using Canvas::_NMODULES;
+	using Canvas::_MODULE;
+	using Canvas::_WIDTH;
+	using Canvas::_HEIGHT;
+	using Canvas::_MODULE_ROWS;
+	using Canvas::_MODULE_GROUPS;
+	using Canvas::_MODULE_BYTES;
+	using Canvas::_XSTRIDE;
+	using Canvas::_YSTRIDE;
+	using Canvas::_SCREENSIZE;
+	using Canvas::_DIRTY_COUNT;
+	using Canvas::_LAST_BUFFER;
+	using Canvas::initBuffers;
+	using Canvas::_BUFFER_ACTIVE;
+	using Canvas::activeBuffer;
+	using Canvas::planeBuffer;
+	using Canvas::pixelIndex;
+	using Canvas::pixelMask;
+	using Canvas::markDirty;
+	using Canvas::isDirty;
+	using Canvas::clearDirty;
+
+	Bus _BUS;
+
+	//Asynchronous transfer state.
+	volatile bool _ASYNC_BUSY;
+	byte * _ASYNC_BUFFER; //Start of the module being sent.
+	byte _ASYNC_CHIP;
+	byte _ASYNC_X;
+	byte _ASYNC_Y;
+	HT1632Callback _ASYNC_CALLBACK;
+
+	//Fixed rate refresh state.
+	volatile byte _REFRESH_TICKS; //Calls between frame starts, 0 = off.
+	byte _REFRESH_COUNT;
+	byte * volatile _REFRESH_READY; //Frame waiting for the next start, NULL: none.
+	byte * volatile _REFRESH_FRONT; //Last frame started.
+	volatile byte _TRIPLE; //HT1632_TRIPLE_xx indexes, 0 = no triple buffer.
+	unsigned long _REFRESH_START;
+	HT1632RefreshStats _REFRESH_STATS;
+
+	//Gray refresh state.
+	byte _GRAY_PLANE; //Plane on the chips.
+	byte _GRAY_TICKS; //Calls left for it.
+
+	//Critical section length.
+	byte _CLI_CHUNK;
+	byte _CLI_COUNT;
+#ifdef HT1632_STATS
+	unsigned long _TICKS; //HT1632_TIMER() ticks summed by statsClock().
+	byte _TICK_LAST;
+	unsigned long _CLI_START;
+	unsigned long _FRAME_START;
+	using Canvas::_STATS;
+	void statsClock();
+#endif
+	void criticalBegin();
+	void criticalEnd();
+	void criticalByte();
+	void frameBegin();	//HT1632_STATS frame count and time.
+	void frameEnd();
+
+	void startWriteScreen(byte * buffer, HT1632Callback done);
+	void writeModule(byte * buffer, byte chip);
+	void writeModuleDirty(byte * buffer, byte chip);
 };
 
+//Pins choosed at runtime. HT1632 matrix = HT1632(DATA, WR, CS);
+typedef HT1632Driver<HT1632Bus<HT1632Pins> > HT1632;
+
+//Pins fixed at compile time, a lot faster. HT1632Fast<DATA, WR, CS> matrix;
+template<byte DATA, byte WCLOCK, byte CHIP0, byte CHIP1 = 0, byte CHIP2 = 0,
+		byte CHIP3 = 0, byte RCLOCK = 0>
+using HT1632Fast = HT1632Driver<HT1632Bus<HT1632FastPins<DATA, WCLOCK, CHIP0, CHIP1, CHIP2, CHIP3, RCLOCK> > >;
+
+//Chips selected through a 74HC164 cascade. HT1632Shift<DATA, WR, CS, CLK, chips> matrix;
+template<byte DATA, byte WCLOCK, byte CSDATA, byte CSCLOCK, byte CHIPS,
+		byte RCLOCK = 0>
+using HT1632Shift = HT1632Driver<HT1632Bus<HT1632ShiftPins<DATA, WCLOCK, CSDATA, CSCLOCK, CHIPS, RCLOCK> > >;
+
+#if defined(__AVR__) || defined(HT1632_HOST)
+//A DATA pin per chip, same port (writeScreenLanes()). HT1632Lanes<HT1632FastSelect<CS0, CS1>, WR, DATA0, DATA1> matrix;
+template<class Select, byte WCLOCK, byte DATA0, byte DATA1, byte DATA2 = 0,
+		byte DATA3 = 0, byte DATA4 = 0, byte DATA5 = 0, byte DATA6 = 0,
+		byte DATA7 = 0>
+using HT1632Lanes = HT1632Driver<HT1632Bus<HT1632LanePins<Select, WCLOCK, DATA0, DATA1, DATA2, DATA3, DATA4, DATA5, DATA6, DATA7> > >;
+
+//Hardware SPI, DATA on MOSI and WR on SCK. HT1632Spi<CS> matrix;
+template<byte CHIP0, byte CHIP1 = 0, byte CHIP2 = 0, byte CHIP3 = 0,
+		byte DIVIDER = HT1632_SPI_DIV8, byte RCLOCK = 0>
+using HT1632Spi = HT1632Driver<HT1632Bus<HT1632SpiPins<CHIP0, CHIP1, CHIP2, CHIP3, DIVIDER, RCLOCK> > >;
+#endif
+
+//Buffers fixed at compile time, no heap. HT1632Static<HT1632FastPins<DATA, WR, CS>, HT1632_MODULE_8X32> matrix;
+template<class Pins, byte MODULE, byte CHIPS = 1, byte BUFFERS = 2,
+		byte LAYOUT = HT1632_LAYOUT_ROWS, byte COLUMNS = 1>
+using HT1632Static = HT1632Driver<HT1632Bus<Pins>, HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS> >;
+
+/*********************************************************/
+
+//All the chips are initialized and cleared at once (broadcast), whatever 'chip' is.
+template<class Bus, class Storage>
+bool HT1632Driver<Bus, Storage>::init(byte /* chip */, byte mode, byte module, byte layout) {
+	bool ok = initBuffers(_BUS.chips(), module, layout);
+
+	//The module of the storage: HT1632StaticStorage ignores 'module'.
+	if (mode == HT1632_COM_MODULE)
+		mode = HT1632Geometry::of(ok ? _MODULE : module).com;
+
+	byte commands[] = {
+		HT1632_CMD_SYSDIS, //Disable system
+		mode, //PMOS drivers
+		HT1632_CMD_RCMASTER, //Master mode
+		HT1632_CMD_SYSEN, //System Enable
+		HT1632_CMD_LEDON //Enable the display
+	};
+
+	_BUS.sendCommands(commands, sizeof(commands), HT1632_ALL_CHIPS);
+	chipClear(HT1632_ALL_CHIPS);
+	return (ok);
+}
+
+//One successive write burst of zeros over the whole RAM. HT1632_ALL_CHIPS clears all at once.
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::chipClear(byte chip) {
+	_BUS.writeSuccesiveStart(0, chip);
+	for (byte i = 0; i < HT1632_RAM_SIZE / 2; i++) {
+		_BUS.writeSuccesiveByte(0);
+	}
+	_BUS.writeSuccesiveStop(chip);
+	_LAST_BUFFER = NULL; //HT1632C ram doesn't match any buffer now.
+}
+
+template<class Bus, class Storage>
+inline void HT1632Driver<Bus, Storage>::sendCommand(byte command, byte chip) {
+	_BUS.sendCommand(command, chip);
+}
+
+template<class Bus, class Storage>
+inline void HT1632Driver<Bus, Storage>::sendCommands(const byte * commands, byte count,
+		byte chip) {
+	_BUS.sendCommands(commands, count, chip);
+}
+
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::setBrightness(byte pwm, byte chip) {
+	_BUS.sendCommand(HT1632_PWM_CONTROL | (pwm & 0xF), chip);
+}
+
+template<class Bus, class Storage>
+byte HT1632Driver<Bus, Storage>::readData(byte address, byte chip) {
+	if (!_BUS.canRead())
+		return (0);
+	return (_BUS.readData(address, chip));
+}
+
+//Reads every chip back (successive read) and compares with the last buffer sent.
+template<class Bus, class Storage>
+bool HT1632Driver<Bus, Storage>::verifyScreen() {
+	byte * buffer = _LAST_BUFFER;
+	bool ok = true;
+
+	if (buffer == NULL || !_BUS.canRead())
+		return (false);
+
+	for (byte chip = 0; chip < _NMODULES && ok; chip++) {
+		_BUS.readSuccesiveStart(0, chip);
+		for (byte x = 0; x < _MODULE_GROUPS && ok; x++) {
+			for (byte y = 0; y < _MODULE_ROWS && ok; y++) {
+				byte data = _BUS.readSuccesive() << 4;
+				data |= _BUS.readSuccesive();
+				ok = (data == buffer[x * _XSTRIDE + y * _YSTRIDE]);
+			}
+		}
+		_BUS.readSuccesiveStop(chip);
+		buffer += _MODULE_BYTES;
+	}
+	return (ok);
+}
+
+/*
+ * Changes one pixel in the chip with a single READ-MODIFY-WRITE of its nibble
+ * (24 clocks instead of a frame). The active buffer gets the pixel too, and if
+ * it's the one on screen it stays clean. Without RD the other 3 pixels of the
+ * nibble come from the last buffer sent (the active one if none), a WRITE.
+ */
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::drawPixelDirect(int x, int y, byte color) {
+	byte chip, group, row, offset, address, mask;
+	byte * buffer = activeBuffer();
+	HT1632Size index;
+
+	if (x < 0 || x >= _WIDTH || y < 0 || y >= _HEIGHT)
+		return;
+
+	index = pixelIndex(x, y);
+	mask = pixelMask(x, y);
+
+	//Back from the buffer byte to the chip and its RAM address.
+	chip = index / _MODULE_BYTES;
+	offset = index - chip * _MODULE_BYTES;
+	group = offset / _XSTRIDE;
+	row = offset / _YSTRIDE;
+	if (_XSTRIDE == 1)
+		group = offset - row * _YSTRIDE;
+	else
+		row = offset - group * _XSTRIDE;
+	//2 nibbles per screen byte, column groups of _MODULE_ROWS bytes.
+	address = ((group * _MODULE_ROWS + row) << 1) + ((mask & 0x0F) ? 1 : 0);
+	if (_BUS.canRead()) {
+		_BUS.readModifyWrite(address, (mask | (mask >> 4)) & 0x0F, color ? 0x0F : 0, chip);
+	} else {
+		byte nibbles = (_LAST_BUFFER ? _LAST_BUFFER : buffer)[index] & ~mask;
+		if (color)
+			nibbles |= mask;
+		_BUS.writeData(address, (mask & 0x0F) ? nibbles & 0x0F : nibbles >> 4, chip);
+	}
+
+	if (color)
+		buffer[index] |= mask;
+	else
+		buffer[index] &= ~mask;
+	if (buffer != _LAST_BUFFER)
+		markDirty(index);
+	HT1632_COUNT(_STATS.pixels, 1);
+}
+
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::blinkMode(bool blink, byte chip) {
+	if (blink) {
+		_BUS.sendCommand(HT1632_CMD_BLINKON, chip);
+	} else {
+		_BUS.sendCommand(HT1632_CMD_BLINKOFF, chip);
+	}
+}
+
+/*
+ * Sends only the screen bytes changed since the last call, one successive
+ * write burst for each run of dirty bytes. Isolated clean bytes between dirty
+ * ones are sent too (8 clocks are cheaper than a new 10 bits burst header).
+ * When most of the screen is dirty, or the buffer isn't the one sent the last
+ * time, every module is sent whole, one burst per chip.
+ */
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::writeScreen() {
+	byte * buffer = activeBuffer();
+	bool full;
+
+	while (_ASYNC_BUSY)
+		; //Wait for the asynchronous transfer.
+
+	full = (buffer != _LAST_BUFFER) || (_DIRTY_COUNT > (_SCREENSIZE >> 1));
+
+	frameBegin();
+	criticalBegin();
+	for (byte chip = 0; chip < _NMODULES; chip++) {
+		if (full)
+			writeModule(buffer, chip);
+		else if (_DIRTY_COUNT)
+			writeModuleDirty(buffer, chip);
+	}
+	criticalEnd();
+	frameEnd();
+
+	clearDirty();
+	_LAST_BUFFER = buffer;
+}
+
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::writeScreenLanes() {
+	byte * buffer = activeBuffer();
+	byte lanes = (_NMODULES < 8) ? _NMODULES : 8;
+	byte data[8];
+
+	while (_ASYNC_BUSY)
+		; //Wait for the asynchronous transfer.
+
+	frameBegin();
+	criticalBegin();
+	_BUS.writeSuccesiveStart(0, HT1632_ALL_CHIPS);
+	for (byte x = 0; x < _MODULE_GROUPS; x++) {
+		for (byte y = 0; y < _MODULE_ROWS; y++) {
+			byte * module = buffer + x * _XSTRIDE + y * _YSTRIDE;
+			for (byte lane = 0; lane < lanes; lane++) {
+				data[lane] = *module;
+				module += _MODULE_BYTES;
+			}
+			_BUS.writeSuccesiveLanes(data, lanes);
+			criticalByte();
+		}
+	}
+	_BUS.writeSuccesiveStop(HT1632_ALL_CHIPS);
+	criticalEnd();
+	frameEnd();
+
+	clearDirty();
+	_LAST_BUFFER = buffer;
+}
+
+//Module 'chip' is the slice of _MODULE_BYTES bytes starting at chip * _MODULE_BYTES.
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::writeModule(byte * buffer, byte chip) {
+	byte * data;
+
+	buffer += chip * _MODULE_BYTES;
+
+	_BUS.writeSuccesiveStart(0, chip);
+	for (byte x = 0; x < _MODULE_GROUPS; x++) {
+		data = buffer + x * _XSTRIDE; //With HT1632_LAYOUT_WIRE it's a linear walk.
+		for (byte y = 0; y < _MODULE_ROWS; y++) {
+			_BUS.writeSuccesiveByte(*data);
+			data += _YSTRIDE;
+			criticalByte();
+		}
+	}
+	_BUS.writeSuccesiveStop(chip);
+}
+
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::writeModuleDirty(byte * buffer, byte chip) {
+	HT1632Size offset = chip * _MODULE_BYTES;
+	byte pairs = _MODULE_BYTES;
+	byte pair = 0; //Pairs (2 nibbles, 1 screen byte) in HT1632C address order.
+	bool burst = false;
+
+	for (byte x = 0; x < _MODULE_GROUPS; x++) {
+		for (byte y = 0; y < _MODULE_ROWS; y++, pair++) {
+			HT1632Size address = offset + x * _XSTRIDE + y * _YSTRIDE;
+			HT1632Size next = (y + 1 < _MODULE_ROWS) ?
+					address + _YSTRIDE : offset + (x + 1) * _XSTRIDE;
+			if (isDirty(address)
+					|| (burst && pair + 1 < pairs && isDirty(next))) {
+				if (!burst) {
+					_BUS.writeSuccesiveStart(pair << 1, chip);
+					burst = true;
+				}
+				_BUS.writeSuccesiveByte(buffer[address]);
+				criticalByte();
+			} else if (burst) {
+				_BUS.writeSuccesiveStop(chip);
+				burst = false;
+			}
+		}
+	}
+	if (burst)
+		_BUS.writeSuccesiveStop(chip);
+}
+
+//The transfer state is written with the interrupts off, the ISR sees it whole.
+template<class Bus, class Storage>
+bool HT1632Driver<Bus, Storage>::beginWriteScreen(HT1632Callback done) {
+	cli();
+	if (_ASYNC_BUSY) {
+		sei();
+		return (false);
+	}
+	startWriteScreen(activeBuffer(), done);
+	sei();
+	return (true);
+}
+
+//Interrupts off: called by beginWriteScreen() and from refreshStep().
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::startWriteScreen(byte * buffer,
+		HT1632Callback done) {
+	_ASYNC_BUFFER = buffer;
+	_ASYNC_CHIP = 0;
+	_ASYNC_X = 0;
+	_ASYNC_Y = 0;
+	_ASYNC_CALLBACK = done;
+	//The whole frame is sent, changes drawn from now on are dirty again.
+	clearDirty();
+	_LAST_BUFFER = _ASYNC_BUFFER;
+	_ASYNC_BUSY = true;
+}
+
+/*
+ * Sends up to 'count' screen bytes of the frame started by beginWriteScreen().
+ * The chip stays selected between calls, the successive write just goes on
+ * with the next clock.
+ */
+template<class Bus, class Storage>
+bool HT1632Driver<Bus, Storage>::writeScreenStep(byte count) {
+	if (!_ASYNC_BUSY)
+		return (false);
+
+	while (count--) {
+		if (_ASYNC_X == 0 && _ASYNC_Y == 0)
+			_BUS.writeSuccesiveStart(0, _ASYNC_CHIP);
+
+		_BUS.writeSuccesiveByte(_ASYNC_BUFFER[_ASYNC_X * _XSTRIDE + _ASYNC_Y * _YSTRIDE]);
+
+		if (++_ASYNC_Y == _MODULE_ROWS) {
+			_ASYNC_Y = 0;
+			if (++_ASYNC_X == _MODULE_GROUPS) {
+				//Module done
+				_ASYNC_X = 0;
+				_BUS.writeSuccesiveStop(_ASYNC_CHIP);
+				_ASYNC_BUFFER += _MODULE_BYTES;
+				if (++_ASYNC_CHIP == _NMODULES) {
+					HT1632_COUNT(_STATS.frames, 1);
+					_ASYNC_BUSY = false;
+					if (_ASYNC_CALLBACK)
+						_ASYNC_CALLBACK();
+					return (false);
+				}
+			}
+		}
+	}
+	return (true);
+}
+
+template<class Bus, class Storage>
+inline bool HT1632Driver<Bus, Storage>::isBusy() {
+	return (_ASYNC_BUSY);
+}
+
+template<class Bus, class Storage>
+bool HT1632Driver<Bus, Storage>::beginRefresh(byte ticks, bool triple) {
+	if (triple && !this->allocateBuffer3())
+		return (false);
+
+	cli();
+	_REFRESH_COUNT = ticks - 1; //First frame at the next call.
+	_REFRESH_READY = NULL;
+	_REFRESH_FRONT = NULL;
+	_TRIPLE = triple ? HT1632_TRIPLE_START : 0;
+	_REFRESH_TICKS = ticks;
+	sei();
+	if (triple)
+		this->setActiveBuffer((HT1632_TRIPLE_START >> 4) & 3);
+	return (true);
+}
+
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::endRefresh() {
+	_REFRESH_TICKS = 0;
+}
+
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::refreshStep() {
+	unsigned long now;
+
+	if (_REFRESH_TICKS && ++_REFRESH_COUNT >= _REFRESH_TICKS) {
+		_REFRESH_COUNT = 0;
+		if (_ASYNC_BUSY) {
+			_REFRESH_STATS.missed++;
+		} else {
+			if (_TRIPLE & HT1632_TRIPLE_FRESH) {
+				//Pending becomes front, the old front is the new pending.
+				_TRIPLE = (_TRIPLE & 0x30) | ((_TRIPLE >> 2) & 0x03) | ((_TRIPLE & 0x03) << 2);
+				_REFRESH_READY = planeBuffer(_TRIPLE & 0x03);
+			}
+			if (_REFRESH_READY) {
+				now = micros();
+				if (_REFRESH_STATS.frames)
+					_REFRESH_STATS.frameTime = now - _REFRESH_START;
+				_REFRESH_START = now;
+				_REFRESH_STATS.frames++;
+				_REFRESH_FRONT = _REFRESH_READY;
+				_REFRESH_READY = NULL;
+				startWriteScreen(_REFRESH_FRONT, NULL);
+			} else {
+				_REFRESH_STATS.repeated++;
+			}
+		}
+	}
+	writeScreenStep();
+}
+
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::frameDone() {
+	byte * buffer = activeBuffer();
+
+	cli();
+	if (_REFRESH_READY)
+		_REFRESH_STATS.dropped++;
+	_REFRESH_READY = buffer;
+	sei();
+
+	this->setActiveBuffer(_BUFFER_ACTIVE ? 0 : 1);
+	buffer = activeBuffer();
+	while (_ASYNC_BUSY && _REFRESH_FRONT == buffer)
+		; //The new drawing buffer is still being sent.
+}
+
+//Back and pending exchange their indexes, in one write of _TRIPLE.
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::present() {
+	byte state;
+
+	if (!_TRIPLE) {
+		frameDone();
+		return;
+	}
+	cli();
+	state = _TRIPLE;
+	if (state & HT1632_TRIPLE_FRESH)
+		_REFRESH_STATS.dropped++;
+	state = (state & 0x03) | ((state & 0x0C) << 2) | ((state & 0x30) >> 2)
+			| HT1632_TRIPLE_FRESH;
+	_TRIPLE = state;
+	sei();
+	this->setActiveBuffer((state >> 4) & 0x03);
+}
+
+//A copy, taken with the interrupts disabled.
+template<class Bus, class Storage>
+HT1632RefreshStats HT1632Driver<Bus, Storage>::getRefreshStats() {
+	HT1632RefreshStats stats;
+
+	cli();
+	stats = _REFRESH_STATS;
+	sei();
+	return (stats);
+}
+
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::resetRefreshStats() {
+	cli();
+	memset((void *) &_REFRESH_STATS, 0, sizeof(_REFRESH_STATS));
+	sei();
+}
+
+/*
+ * Binary coded modulation: plane k stays on the chips 2^k calls, so a pixel
+ * is lit for a time proportional to its level.
+ */
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::writeGrayStep() {
+	byte * buffer;
+	byte chunk = _CLI_CHUNK;
+
+	if (_GRAY_TICKS > 1) {
+		_GRAY_TICKS--;
+		return;
+	}
+	if (_ASYNC_BUSY)
+		return; //Try again the next call.
+
+	if (++_GRAY_PLANE >= this->getGrayBits())
+		_GRAY_PLANE = 0;
+	_GRAY_TICKS = 1 << _GRAY_PLANE;
+
+	buffer = planeBuffer(_GRAY_PLANE);
+	_CLI_CHUNK = 0; //Already inside the interrupt, never enable them.
+	for (byte chip = 0; chip < _NMODULES; chip++)
+		writeModule(buffer, chip);
+	_CLI_CHUNK = chunk;
+	_LAST_BUFFER = NULL; //The chips don't have any buffer.
+	HT1632_COUNT(_STATS.frames, 1);
+}
+
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::setCriticalSection(byte bytes) {
+	_CLI_CHUNK = bytes;
+}
+
+template<class Bus, class Storage>
+inline void HT1632Driver<Bus, Storage>::criticalBegin() {
+	cli();
+	_CLI_COUNT = 0;
+#ifdef HT1632_STATS
+	statsClock();
+	_CLI_START = _TICKS;
+#endif
+}
+
+template<class Bus, class Storage>
+inline void HT1632Driver<Bus, Storage>::criticalEnd() {
+#ifdef HT1632_STATS
+	unsigned long t;
+
+	statsClock();
+	t = HT1632_TIMER_US(_TICKS - _CLI_START);
+	if (t > 0xFFFF)
+		t = 0xFFFF;
+	if (t > _STATS.criticalMax)
+		_STATS.criticalMax = t;
+#endif
+	sei();
+}
+
+template<class Bus, class Storage>
+inline void HT1632Driver<Bus, Storage>::frameBegin() {
+#ifdef HT1632_STATS
+	statsClock();
+	_FRAME_START = _TICKS;
+#endif
+}
+
+template<class Bus, class Storage>
+inline void HT1632Driver<Bus, Storage>::frameEnd() {
+#ifdef HT1632_STATS
+	statsClock();
+	_STATS.frameTime = HT1632_TIMER_US(_TICKS - _FRAME_START);
+	_STATS.frames++;
+#endif
+}
+
+//Called after every screen byte, opens a window for the pending interrupts.
+template<class Bus, class Storage>
+inline void HT1632Driver<Bus, Storage>::criticalByte() {
+#ifdef HT1632_STATS
+	statsClock();
+#endif
+	if (_CLI_CHUNK && ++_CLI_COUNT >= _CLI_CHUNK) {
+		criticalEnd();
+		__asm__ __volatile__ ("nop"); //The instruction after sei runs before any interrupt.
+		criticalBegin();
+	}
+}
+
+#ifdef HT1632_STATS
+//Adds the ticks since the last call. The time before a start is summed too,
+//wrong if it's long, but the intervals are taken after it.
+template<class Bus, class Storage>
+inline void HT1632Driver<Bus, Storage>::statsClock() {
+	byte now = HT1632_TIMER();
+
+	_TICKS += (byte) (now - _TICK_LAST);
+	_TICK_LAST = now;
+}
+
+template<class Bus, class Storage>
+unsigned int HT1632Driver<Bus, Storage>::getCriticalMax() {
+	return (_STATS.criticalMax);
+}
+
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::resetCriticalMax() {
+	_STATS.criticalMax = 0;
+}
+
+//The transport counts the bits and selects, the canvas and driver the rest.
+template<class Bus, class Storage>
+HT1632Stats HT1632Driver<Bus, Storage>::getStats() {
+	HT1632Stats stats = _STATS;
+
+	stats.bits = _BUS.stats.bits;
+	stats.selects = _BUS.stats.selects;
+	return (stats);
+}
+
+template<class Bus, class Storage>
+void HT1632Driver<Bus, Storage>::resetStats() {
+	memset((void *) &_STATS, 0, sizeof(_STATS));
+	memset((void *) &_BUS.stats, 0, sizeof(_BUS.stats));
+}
+#endif
+
+template<class Bus, class Storage>
+inline Bus & HT1632Driver<Bus, Storage>::bus() {
+	return (_BUS);
+}
+
 #endif
@@ -0,0 +1,1011 @@
+/*
+ * HT1632C Driver for Arduino by Luis M. Ruiz - stendall@gmail.com
+ * http://code.google.com/p/ht1632c-driver/
+ * 
+ * Licensed as : CC BY-NC-SA 3.0
+ * For more details see:
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/
+ * 
+ * This Code is based on the work "Holtech HT1632 Driver Class" from
+ * Steven Moughan.
+ * http://hackdev.com/sourcecode/ht1632-driver-arduino/
+ * 
+ * As stated by the license (CC BY_NC_SA 3.0) of the Steven code,
+ * and as this is a derived work, Steven it's not responsible, endorse
+ * or support this code in any implicit or explicit way. 
+ * Constructive criticism, ideas, corrections and patches are welcomed.
+ * Any help to make the code support a broader type of modules will be
+ * greatly appreciated.
+ */
+
+#ifndef HT1632CANVAS_H_h
+#define HT1632CANVAS_H_h
+
+/*
+ * Screen buffers and drawing. Included from HT1632C.h.
+ */
+
+//Screen sizes, buffer offsets and mapping table entries (see HT1632_WIDE).
+#ifdef HT1632_WIDE
+typedef uint16_t HT1632Size;
+#define HT1632_SIZE_MAX		65535
+#else
+typedef byte HT1632Size;
+#define HT1632_SIZE_MAX		255
+#endif
+
+/*
+ * What a module is: the part of the chip matrix it uses and how it's mounted.
+ * The RAM mapping is the same for all: address (group * rows + row) * 2 is the
+ * nibble with the columns 8 * group .. 8 * group + 3 of that row, MSB left.
+ * The buffer keeps that order (see HT1632_LAYOUT_xx), rotation is applied by
+ * the drawing functions through the storage pixelIndex() and pixelMask().
+ */
+struct HT1632Geometry {
+	byte columns;	//ROW lines used, pixels in a row of the chip matrix.
+	byte rows;		//COM lines used.
+	byte com;		//HT1632_CMD_COMxx the module needs.
+	byte rotation;	//HT1632_ROTATE_xx
+
+	//Pixels of the module as mounted.
+	constexpr byte width() {
+		return ((rotation & HT1632_ROTATE_90) ? rows : columns);
+	}
+	constexpr byte height() {
+		return ((rotation & HT1632_ROTATE_90) ? columns : rows);
+	}
+
+	static constexpr HT1632Geometry of(byte module) {
+		return (((module & HT1632_MODULE_MASK) == HT1632_MODULE_8X32) ?
+				HT1632Geometry { 32, 8, HT1632_CMD_COM00, (byte) (module & HT1632_ROTATE_MASK) } :
+				HT1632Geometry { 24, 16, HT1632_CMD_COM11, (byte) (module & HT1632_ROTATE_MASK) });
+	}
+};
+
+/*
+ * Storage
+ * Where the canvas gets its geometry and buffers from. Both give the same
+ * members to HT1632CanvasBase, as variables or as constants.
+ * HT1632HeapStorage is set up at runtime by init() (module type and number of
+ * chips), the buffers are malloc'ed the first time.
+ * HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS> is fixed at
+ * compile time: the sizes are constexpr and the buffers are arrays inside
+ * the object (no heap). init() module and layout are ignored. BUFFERS = 1
+ * saves a buffer, swapBuffers() and setActiveBuffer() do nothing then. The
+ * panels are a COLUMNS wide grid, all with the rotation of MODULE, so the
+ * pixel mapping is arithmetic on the constants, without tables.
+ */
+class HT1632HeapStorage {
+protected:
+	HT1632HeapStorage();
+
+	byte _NMODULES; //number of modules
+	byte _MODULE; //model 32x8 or 24x16, and rotation
+	HT1632Size _WIDTH; //Sum of all modules Width.
+	HT1632Size _HEIGHT; //Sum of all modules Height.
+	byte _MODULE_ROWS; //COM lines of one module.
+	byte _MODULE_GROUPS; //Bytes in a chip row (groups of 8 columns).
+	byte _MODULE_BYTES; //Bytes of one module.
+	byte _XSTRIDE; //Buffer distance between two column groups of a module.
+	byte _YSTRIDE; //Buffer distance between two rows of a module.
+	HT1632Size _SCREENSIZE; //Bytes, not pixels
+	byte * _SCREEN_BUFFER1;
+	byte * _SCREEN_BUFFER2;
+	byte * _SCREEN_BUFFER3; //Only for 3 gray planes, allocated on demand.
+	byte * _DIRTY;
+	byte _COLUMNS; //Panels in a row of the grid.
+	HT1632Size * _XBAND; //Mapping tables (see HT1632CanvasBase::arrange()).
+	HT1632Size * _YBAND;
+	HT1632Size * _XINDEX;
+	byte * _XMASK;
+	HT1632Size * _YINDEX;
+	byte * _YMASK;
+	byte _BUFFER_MALLOC;
+
+	bool allocate(byte nmodules, byte module, byte layout);	//false if there's no memory for the buffers or too many modules.
+	bool allocateMap(HT1632Size width, HT1632Size height, byte bands, byte columns);	//The mapping tables for a width x height screen.
+	bool allocateBuffer3();	//The third screen buffer, after allocate().
+
+	//Buffer byte and bit of the screen pixel x,y (inside the screen), through the tables of arrange().
+	inline HT1632Size pixelIndex(HT1632Size x, HT1632Size y) {
+		return (_XINDEX[_YBAND[y] + x] + _YINDEX[_XBAND[x] + y]);
+	}
+	inline byte pixelMask(HT1632Size x, HT1632Size y) {
+		return (_XMASK[_YBAND[y] + x] & _YMASK[_XBAND[x] + y]);
+	}
+};
+
+template<byte MODULE, byte CHIPS = 1, byte BUFFERS = 2,
+		byte LAYOUT = HT1632_LAYOUT_ROWS, byte COLUMNS = 1>
+class HT1632StaticStorage {
+protected:
+	HT1632StaticStorage() :
+			_SCREEN_BUFFER1(_BUFFERS[0]), _SCREEN_BUFFER2(_BUFFERS[BUFFERS > 1 ? 1 : 0]),
+			_SCREEN_BUFFER3(BUFFERS > 2 ? _BUFFERS[2] : NULL) {
+	}
+
+	static constexpr byte _NMODULES = CHIPS;
+	static constexpr byte _MODULE = MODULE;
+	static constexpr byte _COLUMNS = COLUMNS;
+	static constexpr HT1632Size _WIDTH = HT1632Geometry::of(MODULE).width() * COLUMNS;
+	static constexpr HT1632Size _HEIGHT = HT1632Geometry::of(MODULE).height() * (CHIPS / COLUMNS);
+	static constexpr byte _MODULE_ROWS = HT1632Geometry::of(MODULE).rows;
+	static constexpr byte _MODULE_GROUPS = HT1632Geometry::of(MODULE).columns >> 3;
+	static constexpr byte _MODULE_BYTES = _MODULE_ROWS * _MODULE_GROUPS;
+	static constexpr byte _XSTRIDE = (LAYOUT == HT1632_LAYOUT_WIRE) ? _MODULE_ROWS : 1;
+	static constexpr byte _YSTRIDE = (LAYOUT == HT1632_LAYOUT_WIRE) ? 1 : _MODULE_GROUPS;
+	static constexpr HT1632Size _SCREENSIZE = _MODULE_BYTES * CHIPS;
+	//The panel as mounted and where its pixels are in the chip matrix.
+	static constexpr byte _ROTATION = MODULE & HT1632_ROTATE_MASK;
+	static constexpr byte _PANEL_WIDTH = HT1632Geometry::of(MODULE).width();
+	static constexpr byte _PANEL_HEIGHT = HT1632Geometry::of(MODULE).height();
+	static constexpr byte _CHIP_COLUMNS = HT1632Geometry::of(MODULE).columns;
+
+	static_assert(CHIPS > 0 && (long) CHIPS * HT1632Geometry::of(MODULE).rows * (HT1632Geometry::of(MODULE).columns >> 3) <= HT1632_SIZE_MAX,
+			"The screen buffer is too big for HT1632Size (see HT1632_WIDE)");
+	static_assert(BUFFERS >= 1 && BUFFERS <= 3, "1 to 3 screen buffers");
+	static_assert(COLUMNS > 0 && CHIPS % COLUMNS == 0, "Full rows of panels");
+	static_assert((long) _PANEL_WIDTH * COLUMNS <= HT1632_SIZE_MAX
+			&& (long) _PANEL_HEIGHT * (CHIPS / COLUMNS) <= HT1632_SIZE_MAX,
+			"The screen is too big for HT1632Size (see HT1632_WIDE)");
+
+	byte _BUFFERS[BUFFERS][_SCREENSIZE];
+	byte _DIRTY[(_SCREENSIZE + 7) >> 3];
+	byte * _SCREEN_BUFFER1;
+	byte * _SCREEN_BUFFER2;
+	byte * _SCREEN_BUFFER3;
+
+	bool allocate(byte /* nmodules */, byte /* module */, byte /* layout */) {
+		return (true);
+	}
+	bool allocateBuffer3() {
+		return (BUFFERS > 2);
+	}
+	bool allocateMap(HT1632Size width, HT1632Size height, byte bands, byte columns) {
+		return (width == _WIDTH && height == _HEIGHT && bands == 1
+				&& columns == COLUMNS);
+	}
+
+	//The same as the tables of arrange() for this grid, folded by the compiler.
+	inline HT1632Size pixelIndex(HT1632Size x, HT1632Size y) {
+		HT1632Size column = COLUMNS > 1 ? x / _PANEL_WIDTH : 0;
+		HT1632Size row = CHIPS > COLUMNS ? y / _PANEL_HEIGHT : 0;
+		byte local = chipColumn(x - column * _PANEL_WIDTH, y - row * _PANEL_HEIGHT);
+
+		return ((row * COLUMNS + column) * _MODULE_BYTES + (local >> 3) * _XSTRIDE
+				+ chipRow(x - column * _PANEL_WIDTH, y - row * _PANEL_HEIGHT) * _YSTRIDE);
+	}
+	inline byte pixelMask(HT1632Size x, HT1632Size y) {
+		HT1632Size column = COLUMNS > 1 ? x / _PANEL_WIDTH : 0;
+		HT1632Size row = CHIPS > COLUMNS ? y / _PANEL_HEIGHT : 0;
+
+		return (0x80 >> (chipColumn(x - column * _PANEL_WIDTH, y - row * _PANEL_HEIGHT) & 7));
+	}
+	//Chip matrix column and row of the pixel x,y of a panel.
+	static inline byte chipColumn(byte x, byte y) {
+		return (_ROTATION == HT1632_ROTATE_0 ? x :
+				_ROTATION == HT1632_ROTATE_180 ? _CHIP_COLUMNS - 1 - x :
+				_ROTATION == HT1632_ROTATE_90 ? y : _CHIP_COLUMNS - 1 - y);
+	}
+	static inline byte chipRow(byte x, byte y) {
+		return (_ROTATION == HT1632_ROTATE_0 ? y :
+				_ROTATION == HT1632_ROTATE_180 ? _MODULE_ROWS - 1 - y :
+				_ROTATION == HT1632_ROTATE_90 ? _MODULE_ROWS - 1 - x : x);
+	}
+};
+
+/*
+ * Screen buffer and drawing functions. They don't touch the HT1632C, so they
+ * are shared by all the transports.
+ */
+template<class Storage>
+class HT1632CanvasBase: protected Storage {
+public:
+	HT1632CanvasBase();
+
+	/*
+	 * All x,y screen coordinates can be negatives and therefore use it to make scroll/displace effects
+	 * All following functions draw to Screen buffer (active)
+	 * -->
+	 */
+
+	void clearScreen(); 					//Clear memory of active buffer. Fill with zeros
+	void fillScreen();						//Fill memory of active buffer. Fill with 0xFF
+	void setByte(int address, byte d);		//Write a byte 'd' at the memory 'address' of the active screen buffer
+	void drawPixel(int x, int y, byte color = 1); //Draws a pixel with the choosed color.
+	byte getPixel(int x, int y);			//Return the pixel value at x,y position in screen buffer.
+	void setPixel(int x, int y);			//Same that DrawPixel but always lit pixel.
+	void clearPixel(int x, int y);			//Same that DrawPixel but always dark pixel.
+	void drawLine(int x1, int y1, int x2, int y2, byte color = 1);
+	void drawRect(int x, int y, int w, int h, byte color = 1);
+	void fillRect(int x, int y, int w, int h, byte color = 1);
+	void drawCircle(int x0, int y0, byte r, byte color = 1);
+	void fillCircle(int x0, int y0, byte r, byte color = 1);
+	void drawChar(int x, int y, char c, byte color = 1); // Puts character 'c' at x,y position.
+	void drawString(int x, int y, const char* str, byte color); // Write string 'str' at x,y position.
+	void animateDown();						//Move down 1 pixel at time the whole screen buffer content.
+	/*
+	 * <--
+	 */
+	void setActiveBuffer(byte b);//Change the active buffer where draw functions operate (2: third gray plane).
+	void swapBuffers();			//Exchange Active (front buffer on DumpScreen) and back buffer. Double buffer.
+	byte getActiveBuffer();		//Returns the number of the current buffer;
+
+	/*
+	 * Panels in a grid 'columns' wide instead of stacked. Chip n is the panel
+	 * n % columns, n / columns of the grid, rotated by rotations[n]
+	 * (HT1632_ROTATE_xx, NULL: as the init() module). The panels of a grid
+	 * column must be equally wide and those of a grid row equally tall. false
+	 * if they aren't or there's no memory (HT1632StaticStorage: only its own
+	 * COLUMNS, all with the rotation of its MODULE). The screen is cleared.
+	 */
+	bool arrange(byte columns, const byte * rotations = NULL);
+
+	/*
+	 * Grayscale by bit-planes. With setGrayBits(2) or (3) the screen buffers
+	 * 0, 1 (and 2) are the planes of a 4 (8) level image, plane k holds bit k
+	 * of every pixel level. The driver shows plane k 2^k times longer than
+	 * plane 0 (see HT1632Driver::writeGrayStep()). The other drawing functions
+	 * draw in the plane chosen with setActiveBuffer(k). 3 planes need a third
+	 * buffer: malloc with the heap, BUFFERS = 3 with HT1632StaticStorage.
+	 */
+	bool setGrayBits(byte bits);	//1 (no gray), 2 or 3. false if there's no third buffer.
+	byte getGrayBits();
+	void drawPixelGray(int x, int y, byte level); //Level 0 (off) .. 2^bits - 1 (full on).
+	byte getPixelGray(int x, int y);
+
+protected:
+	using Storage::_NMODULES;
+	using Storage::_MODULE;
+	using Storage::_WIDTH;
+	using Storage::_HEIGHT;
+	using Storage::_MODULE_ROWS;
+	using Storage::_MODULE_GROUPS;
+	using Storage::_MODULE_BYTES;
+	using Storage::_XSTRIDE;
+	using Storage::_YSTRIDE;
+	using Storage::_SCREENSIZE;
+	using Storage::_SCREEN_BUFFER1;
+	using Storage::_SCREEN_BUFFER2;
+	using Storage::_SCREEN_BUFFER3;
+	using Storage::_COLUMNS;
+	byte _BUFFER_ACTIVE;
+	byte _GRAY_BITS;
+
+	/*
+	 * Dirty tracking: 1 bit per screen byte (2 HT1632C nibbles), set when the
+	 * byte changes after the last writeScreen(). Only valid for the buffer
+	 * in _LAST_BUFFER, any other buffer is dumped whole.
+	 */
+	using Storage::_DIRTY;
+	HT1632Size _DIRTY_COUNT;
+	byte * _LAST_BUFFER; //Buffer sent by the last writeScreen().
+#ifdef HT1632_STATS
+	HT1632Stats _STATS; //The drawing and driver counters.
+#endif
+
+	bool initBuffers(byte nmodules, byte module, byte layout);	//Allocate (only first time) and clear the screen buffers. false: 0x0 screen.
+	byte * activeBuffer();
+	byte * planeBuffer(byte plane);	//Gray plane 'plane' (screen buffer 0, 1 or 2).
+	//Buffer byte and bit of the screen pixel x,y (inside the screen), for any layout and arrangement.
+	using Storage::pixelIndex;
+	using Storage::pixelMask;
+	bool mapPanels(byte columns, const byte * rotations, HT1632Size width,
+			HT1632Size height, HT1632HeapStorage * storage);
+	template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+	bool mapPanels(byte columns, const byte * rotations, HT1632Size width,
+			HT1632Size height, HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS> * storage);
+	byte panelRotation(byte chip, const byte * rotations);
+	bool sameRotations(byte row1, byte row2, byte columns, const byte * rotations);
+	byte rowBand(byte row, byte columns, const byte * rotations);
+	inline void markDirty(HT1632Size address) {
+		byte mask = 1 << (address & 7);
+		if ((_DIRTY[address >> 3] & mask) == 0) {
+			_DIRTY[address >> 3] |= mask;
+			_DIRTY_COUNT++;
+		}
+	}
+	inline bool isDirty(HT1632Size address) {
+		return ((_DIRTY[address >> 3] & (1 << (address & 7))) != 0);
+	}
+	void markAllDirty();
+	void clearDirty();
+};
+
+//The canvas sized at runtime by init().
+typedef HT1632CanvasBase<HT1632HeapStorage> HT1632Canvas;
+//Its code is compiled once, in HT1632C.cpp.
+extern template class HT1632CanvasBase<HT1632HeapStorage>;
+
+/*********************************************************/
+
+//ODR definitions of the constants (C++11).
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr byte HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_NMODULES;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr byte HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_MODULE;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr byte HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_COLUMNS;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr HT1632Size HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_WIDTH;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr HT1632Size HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_HEIGHT;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr byte HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_MODULE_ROWS;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr byte HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_MODULE_GROUPS;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr byte HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_MODULE_BYTES;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr byte HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_XSTRIDE;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr byte HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_YSTRIDE;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr HT1632Size HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_SCREENSIZE;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr byte HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_ROTATION;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr byte HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_PANEL_WIDTH;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr byte HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_PANEL_HEIGHT;
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+constexpr byte HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS>::_CHIP_COLUMNS;
+
+#define HT1632_SWAP(a, b) { int t = a; a = b; b = t; }
+
+template<class Storage>
+HT1632CanvasBase<Storage>::HT1632CanvasBase() {
+	_BUFFER_ACTIVE = 0;
+	_GRAY_BITS = 1;
+	_DIRTY_COUNT = 0;
+	_LAST_BUFFER = NULL;
+#ifdef HT1632_STATS
+	memset((void *) &_STATS, 0, sizeof(_STATS));
+#endif
+}
+
+template<class Storage>
+bool HT1632CanvasBase<Storage>::initBuffers(byte nmodules, byte module,
+		byte layout) {
+	if (!Storage::allocate(nmodules, module, layout))
+		return (false);
+	_BUFFER_ACTIVE = 0;
+	return (arrange(_COLUMNS));
+}
+
+/*
+ * The mapping tables. A screen pixel x,y is in the panel of grid column 'c'
+ * and grid row 'r'. Its buffer byte is the sum of a part that depends on x
+ * and the rotation of the panels in row r (_XINDEX band of row r, _YBAND[y]
+ * tells where it starts) and another that depends on y and the panel
+ * itself (_YINDEX band of column c, from _XBAND[x]). Same for the bit mask.
+ * Rows with the same rotations share their band, so a stack of panels has
+ * just 1 _XINDEX band. HT1632StaticStorage has no tables, see its
+ * pixelIndex().
+ */
+template<class Storage>
+bool HT1632CanvasBase<Storage>::arrange(byte columns, const byte * rotations) {
+	HT1632Geometry geometry = HT1632Geometry::of(_MODULE);
+	byte rows, bands;
+	HT1632Size width, height;
+
+	if (columns == 0 || _NMODULES == 0 || _NMODULES % columns)
+		return (false);
+	rows = _NMODULES / columns;
+
+	//Size of the grid, every column and row of panels must be even.
+	width = 0;
+	height = 0;
+	for (byte chip = 0; chip < _NMODULES; chip++) {
+		HT1632Geometry column = geometry;
+		HT1632Geometry row = geometry;
+		geometry.rotation = panelRotation(chip, rotations);
+		column.rotation = panelRotation(chip % columns, rotations); //First panel of its grid column...
+		row.rotation = panelRotation(chip - chip % columns, rotations); //... and of its grid row.
+		if (geometry.width() != column.width() || geometry.height() != row.height())
+			return (false);
+		if (chip < columns)
+			width += geometry.width();
+		if (chip % columns == 0)
+			height += geometry.height();
+	}
+	bands = 0;
+	for (byte row = 0; row < rows; row++) {
+		if (rowBand(row, columns, rotations) == bands)
+			bands++;
+	}
+	if ((long) bands * width > HT1632_SIZE_MAX
+			|| (long) columns * height > HT1632_SIZE_MAX
+			|| !Storage::allocateMap(width, height, bands, columns)
+			|| !mapPanels(columns, rotations, width, height, this))
+		return (false);
+
+	clearScreen();
+	markAllDirty();
+	return (true);
+}
+
+//The tables of arrange(), HT1632HeapStorage.
+template<class Storage>
+bool HT1632CanvasBase<Storage>::mapPanels(byte columns, const byte * rotations,
+		HT1632Size width, HT1632Size height, HT1632HeapStorage * /* storage */) {
+	HT1632Geometry geometry = HT1632Geometry::of(_MODULE);
+	byte gridColumns = _MODULE_GROUPS << 3;
+	byte rows = _NMODULES / columns;
+	byte p;
+	HT1632Size x, y;
+
+	//Bands of each screen column and row.
+	x = 0;
+	for (byte column = 0; column < columns; column++) {
+		geometry.rotation = panelRotation(column, rotations);
+		for (p = 0; p < geometry.width(); p++)
+			this->_XBAND[x++] = column * height;
+	}
+	y = 0;
+	for (byte row = 0; row < rows; row++) {
+		geometry.rotation = panelRotation(row * columns, rotations);
+		for (p = 0; p < geometry.height(); p++)
+			this->_YBAND[y++] = rowBand(row, columns, rotations) * width;
+	}
+
+	//x part: chip column (0, 180) or chip row (90, 270) of the panel.
+	for (byte row = 0; row < rows; row++) {
+		HT1632Size * index = this->_XINDEX + rowBand(row, columns, rotations) * width;
+		byte * mask = this->_XMASK + (index - this->_XINDEX);
+		x = 0;
+		for (byte column = 0; column < columns; column++) {
+			geometry.rotation = panelRotation(row * columns + column, rotations);
+			for (byte local = 0; local < geometry.width(); local++, x++) {
+				switch (geometry.rotation) {
+				case HT1632_ROTATE_0:
+				case HT1632_ROTATE_180:
+					p = (geometry.rotation == HT1632_ROTATE_0) ? local : gridColumns - 1 - local;
+					index[x] = (p >> 3) * _XSTRIDE;
+					mask[x] = 0x80 >> (p & 7);
+					break;
+				default:
+					p = (geometry.rotation == HT1632_ROTATE_270) ? local : _MODULE_ROWS - 1 - local;
+					index[x] = p * _YSTRIDE;
+					mask[x] = 0xFF;
+					break;
+				}
+			}
+		}
+	}
+	//y part: the panel slice of the buffer and the other chip axis.
+	for (byte column = 0; column < columns; column++) {
+		HT1632Size * index = this->_YINDEX + column * height;
+		byte * mask = this->_YMASK + column * height;
+		y = 0;
+		for (byte row = 0; row < rows; row++) {
+			byte chip = row * columns + column;
+			geometry.rotation = panelRotation(chip, rotations);
+			for (byte local = 0; local < geometry.height(); local++, y++) {
+				switch (geometry.rotation) {
+				case HT1632_ROTATE_0:
+				case HT1632_ROTATE_180:
+					p = (geometry.rotation == HT1632_ROTATE_0) ? local : _MODULE_ROWS - 1 - local;
+					index[y] = chip * _MODULE_BYTES + p * _YSTRIDE;
+					mask[y] = 0xFF;
+					break;
+				default:
+					p = (geometry.rotation == HT1632_ROTATE_90) ? local : gridColumns - 1 - local;
+					index[y] = chip * _MODULE_BYTES + (p >> 3) * _XSTRIDE;
+					mask[y] = 0x80 >> (p & 7);
+					break;
+				}
+			}
+		}
+	}
+
+	return (true);
+}
+
+//HT1632StaticStorage maps with its constants: only its own rotation.
+template<class Storage>
+template<byte MODULE, byte CHIPS, byte BUFFERS, byte LAYOUT, byte COLUMNS>
+bool HT1632CanvasBase<Storage>::mapPanels(byte /* columns */, const byte * rotations,
+		HT1632Size /* width */, HT1632Size /* height */,
+		HT1632StaticStorage<MODULE, CHIPS, BUFFERS, LAYOUT, COLUMNS> * /* storage */) {
+	for (byte chip = 0; chip < _NMODULES; chip++) {
+		if (panelRotation(chip, rotations) != (MODULE & HT1632_ROTATE_MASK))
+			return (false);
+	}
+	return (true);
+}
+
+template<class Storage>
+inline byte HT1632CanvasBase<Storage>::panelRotation(byte chip,
+		const byte * rotations) {
+	if (rotations)
+		return (rotations[chip] & HT1632_ROTATE_MASK);
+	return (_MODULE & HT1632_ROTATE_MASK);
+}
+
+template<class Storage>
+bool HT1632CanvasBase<Storage>::sameRotations(byte row1, byte row2,
+		byte columns, const byte * rotations) {
+	for (byte column = 0; column < columns; column++) {
+		if (panelRotation(row1 * columns + column, rotations)
+				!= panelRotation(row2 * columns + column, rotations))
+			return (false);
+	}
+	return (true);
+}
+
+//Band of the grid row 'row': rows with the same rotations share it, numbered as they first appear.
+template<class Storage>
+byte HT1632CanvasBase<Storage>::rowBand(byte row, byte columns,
+		const byte * rotations) {
+	byte first = 0;
+	byte band = 0;
+
+	while (!sameRotations(first, row, columns, rotations))
+		first++;
+	for (byte previous = 0; previous < first; previous++) {
+		byte other = 0;
+		while (!sameRotations(other, previous, columns, rotations))
+			other++;
+		if (other == previous)
+			band++;
+	}
+	return (band);
+}
+
+template<class Storage>
+void HT1632CanvasBase<Storage>::markAllDirty() {
+	memset((void *) _DIRTY, 255, (_SCREENSIZE + 7) >> 3);
+	_DIRTY_COUNT = _SCREENSIZE;
+}
+
+template<class Storage>
+void HT1632CanvasBase<Storage>::clearDirty() {
+	memset((void *) _DIRTY, 0, (_SCREENSIZE + 7) >> 3);
+	_DIRTY_COUNT = 0;
+}
+
+template<class Storage>
+inline byte * HT1632CanvasBase<Storage>::activeBuffer() {
+	return (planeBuffer(_BUFFER_ACTIVE));
+}
+
+template<class Storage>
+inline byte * HT1632CanvasBase<Storage>::planeBuffer(byte plane) {
+	if (plane == 0)
+		return (_SCREEN_BUFFER1);
+	else if (plane == 1)
+		return (_SCREEN_BUFFER2);
+	else
+		return (_SCREEN_BUFFER3);
+}
+
+template<class Storage>
+void HT1632CanvasBase<Storage>::clearScreen() {
+	byte * buffer = activeBuffer();
+
+	//Only the bytes that change get dirty.
+	for (HT1632Size i = 0; i < _SCREENSIZE; i++) {
+		if (buffer[i] != 0) {
+			buffer[i] = 0;
+			markDirty(i);
+		}
+	}
+}
+
+template<class Storage>
+void HT1632CanvasBase<Storage>::fillScreen() {
+	byte * buffer = activeBuffer();
+
+	for (HT1632Size i = 0; i < _SCREENSIZE; i++) {
+		if (buffer[i] != 255) {
+			buffer[i] = 255;
+			markDirty(i);
+		}
+	}
+}
+
+template<class Storage>
+void HT1632CanvasBase<Storage>::setByte(int address, byte d) {
+	byte * buffer;
+	buffer = activeBuffer();
+
+	if (*(byte*) (buffer + address) != d) {
+		*(byte*) (buffer + address) = d;
+		markDirty(address);
+	}
+	HT1632_COUNT(_STATS.pixels, 8);
+}
+
+template<class Storage>
+void HT1632CanvasBase<Storage>::drawPixel(int x, int y, byte color) {
+	unsigned int address;
+	byte * buffer;
+	byte mask;
+	byte old;
+
+	if (x < 0 || x >= _WIDTH || y < 0 || y >= _HEIGHT)
+		return;
+
+	buffer = activeBuffer();
+
+	address = pixelIndex(x, y);
+	mask = pixelMask(x, y);
+
+	old = *(byte *) (buffer + address);
+	if (color == 1)
+		*(byte *) (buffer + address) |= mask;
+	else
+		*(byte *) (buffer + address) &= ~mask;
+
+	if (*(byte *) (buffer + address) != old)
+		markDirty(address);
+	HT1632_COUNT(_STATS.pixels, 1);
+}
+
+template<class Storage>
+byte HT1632CanvasBase<Storage>::getPixel(int x, int y) {
+	unsigned int address;
+	byte * buffer;
+
+	if (x < 0 || x >= _WIDTH || y < 0 || y >= _HEIGHT)
+		return (0);
+
+	buffer = activeBuffer();
+
+	address = pixelIndex(x, y);
+
+	if (((*(byte *) (buffer + address)) & pixelMask(x, y)) != 0)
+		return (1);
+	else
+		return (0);
+
+}
+
+template<class Storage>
+void HT1632CanvasBase<Storage>::setPixel(int x, int y) {
+	drawPixel(x, y, 1);
+}
+
+template<class Storage>
+void HT1632CanvasBase<Storage>::clearPixel(int x, int y) {
+	drawPixel(x, y, 0);
+}
+
+template<class Storage>
+void HT1632CanvasBase<Storage>::drawLine(int x1, int y1, int x2, int y2, byte color) {
+	int F, x, y;
+
+	if (x1 > x2)  // Swap points if p1 is on the right of p2
+			{
+		HT1632_SWAP(x1, x2);
+		HT1632_SWAP(y1, y2);
+	}
+
+	// Handle trivial cases separately for algorithm speed up.
+	// Trivial case 1: m = +/-INF (Vertical line)
+	if (x1 == x2) {
+		if (y1 > y2)  // Swap y-coordinates if p1 is above p2
+				{
+			HT1632_SWAP(y1, y2);
+		}
+
+		x = x1;
+		y = y1;
+		while (y <= y2) {
+			drawPixel(x, y, color);
+			y++;
+		}
+		return;
+	}
+	// Trivial case 2: m = 0 (Horizontal line)
+	else if (y1 == y2) {
+		x = x1;
+		y = y1;
+
+		while (x <= x2) {
+			drawPixel(x, y, color);
+			x++;
+		}
+		return;
+	}
+
+	int dy = y2 - y1;  // y-increment from p1 to p2
+	int dx = x2 - x1;  // x-increment from p1 to p2
+	int dy2 = (dy << 1);  // dy << 1 == 2*dy
+	int dx2 = (dx << 1);
+	int dy2_minus_dx2 = dy2 - dx2;  // precompute constant for speed up
+	int dy2_plus_dx2 = dy2 + dx2;
+
+	if (dy >= 0)    // m >= 0
+			{
+		// Case 1: 0 <= m <= 1 (Original case)
+		if (dy <= dx) {
+			F = dy2 - dx;    // initial F
+
+			x = x1;
+			y = y1;
+			while (x <= x2) {
+				drawPixel(x, y, color);
+				if (F <= 0) {
+					F += dy2;
+				} else {
+					y++;
+					F += dy2_minus_dx2;
+				}
+				x++;
+			}
+		}
+		// Case 2: 1 < m < INF (Mirror about y=x line
+		// replace all dy by dx and dx by dy)
+		else {
+			F = dx2 - dy;    // initial F
+
+			y = y1;
+			x = x1;
+			while (y <= y2) {
+				drawPixel(x, y, color);
+				if (F <= 0) {
+					F += dx2;
+				} else {
+					x++;
+					F -= dy2_minus_dx2;
+				}
+				y++;
+			}
+		}
+	} else    // m < 0
+	{
+		// Case 3: -1 <= m < 0 (Mirror about x-axis, replace all dy by -dy)
+		if (dx >= -dy) {
+			F = -dy2 - dx;    // initial F
+
+			x = x1;
+			y = y1;
+			while (x <= x2) {
+				drawPixel(x, y, color);
+				if (F <= 0) {
+					F -= dy2;
+				} else {
+					y--;
+					F -= dy2_plus_dx2;
+				}
+				x++;
+			}
+		}
+		// Case 4: -INF < m < -1 (Mirror about x-axis and mirror
+		// about y=x line, replace all dx by -dy and dy by dx)
+		else {
+			F = dx2 + dy;    // initial F
+
+			y = y1;
+			x = x1;
+			while (y >= y2) {
+				drawPixel(x, y, color);
+				if (F <= 0) {
+					F += dx2;
+				} else {
+					x++;
+					F += dy2_plus_dx2;
+				}
+				y--;
+			}
+		}
+	}
+}
+
+// draw a rectangle
+template<class Storage>
+void HT1632CanvasBase<Storage>::drawRect(int x, int y, int w, int h, byte color) {
+	drawLine(x, y, x + w - 1, y, color);
+	drawLine(x, y + h - 1, x + w - 1, y + h - 1, color);
+
+	drawLine(x, y, x, y + h - 1, color);
+	drawLine(x + w - 1, y, x + w - 1, y + h - 1, color);
+}
+
+// fill a rectangle
+// TODO Use lines (maybe fastest instead pixel writes)
+template<class Storage>
+void HT1632CanvasBase<Storage>::fillRect(int x, int y, int w, int h, byte color) {
+	for (int i = x; i < x + w; i++) {
+		for (int j = y; j < y + h; j++) {
+			drawPixel(i, j, color);
+		}
+	}
+}
+
+// draw a circle outline
+template<class Storage>
+void HT1632CanvasBase<Storage>::drawCircle(int x0, int y0, byte r, byte color) {
+	int16_t f = 1 - r;
+	int16_t ddF_x = 1;
+	int16_t ddF_y = -2 * r;
+	int16_t x = 0;
+	int16_t y = r;
+
+	drawPixel(x0, y0 + r, color);
+	drawPixel(x0, y0 - r, color);
+	drawPixel(x0 + r, y0, color);
+	drawPixel(x0 - r, y0, color);
+
+	while (x < y) {
+		if (f >= 0) {
+			y--;
+			ddF_y += 2;
+			f += ddF_y;
+		}
+		x++;
+		ddF_x += 2;
+		f += ddF_x;
+
+		drawPixel(x0 + x, y0 + y, color);
+		drawPixel(x0 - x, y0 + y, color);
+		drawPixel(x0 + x, y0 - y, color);
+		drawPixel(x0 - x, y0 - y, color);
+
+		drawPixel(x0 + y, y0 + x, color);
+		drawPixel(x0 - y, y0 + x, color);
+		drawPixel(x0 + y, y0 - x, color);
+		drawPixel(x0 - y, y0 - x, color);
+
+	}
+}
+
+// fill a circle
+template<class Storage>
+void HT1632CanvasBase<Storage>::fillCircle(int x0, int y0, byte r, byte color) {
+	int16_t f = 1 - r;
+	int16_t ddF_x = 1;
+	int16_t ddF_y = -2 * r;
+	int16_t x = 0;
+	int16_t y = r;
+
+	drawLine(x0, y0 - r, x0, y0 + r + 1, color);
+
+	while (x < y) {
+		if (f >= 0) {
+			y--;
+			ddF_y += 2;
+			f += ddF_y;
+		}
+		x++;
+		ddF_x += 2;
+		f += ddF_x;
+
+		drawLine(x0 + x, y0 - y, x0 + x, y0 + y + 1, color);
+		drawLine(x0 - x, y0 - y, x0 - x, y0 + y + 1, color);
+		drawLine(x0 + y, y0 - x, x0 + y, y0 + x + 1, color);
+		drawLine(x0 - y, y0 - x, x0 - y, y0 + x + 1, color);
+	}
+}
+
+template<class Storage>
+void HT1632CanvasBase<Storage>::drawChar(int x, int y, char c, byte color) {
+	byte bit;
+	int x1, y1;
+
+	for (x1 = 0; x1 < FONT_WIDTH; x1++) {
+		//detect if we're drawing row outside screen and jump next cycle
+		if (x1 + x > _WIDTH || x1 + x < 0)
+			continue;
+		bit = pgm_read_byte(&font[c-32][x1]);
+		for (y1 = 0; y1 < FONT_HEIGHT; y1++) {
+			//detect if we're drawing column outside screen and jump next cycle
+			if (y1 + y > _HEIGHT || y1 + y < 0)
+				continue;
+			if ((bit & (1 << (FONT_HEIGHT - y1))) != 0)
+				drawPixel(x + x1, y + y1 - 1, color);
+		}
+	}
+}
+template<class Storage>
+void HT1632CanvasBase<Storage>::drawString(int x, int y, const char* str, byte color) {
+	int i = 0;
+	int x1 = 0;
+	//char newline=10;
+	while (str[i] != 0) {
+		drawChar(x + (x1 * FONT_WIDTH), y, str[i], color);
+		x1++;
+		i++;
+		if (str[i] == 10) { //check against "\n"
+			y += FONT_HEIGHT;
+			x1 = 0;
+			i++;
+		}
+	}
+}
+
+template<class Storage>
+void HT1632CanvasBase<Storage>::setActiveBuffer(byte b) {
+	if (b == 0)
+		_BUFFER_ACTIVE = 0;
+	else if (b == 2 && _SCREEN_BUFFER3)
+		_BUFFER_ACTIVE = 2;
+	else
+		_BUFFER_ACTIVE = 1;
+}
+
+template<class Storage>
+void HT1632CanvasBase<Storage>::swapBuffers() {
+	byte * temp = _SCREEN_BUFFER1;
+	_SCREEN_BUFFER1 = _SCREEN_BUFFER2;
+	_SCREEN_BUFFER2 = temp;
+}
+
+template<class Storage>
+byte HT1632CanvasBase<Storage>::getActiveBuffer() {
+	return (_BUFFER_ACTIVE);
+}
+
+template<class Storage>
+void HT1632CanvasBase<Storage>::animateDown() {
+	byte pixel;
+
+	for (int y = _HEIGHT - 1; y >= 0; y--) {
+		for (HT1632Size x = 0; x < _WIDTH; x++) {
+			pixel = getPixel(x, y - 1);
+			if (pixel != 0)
+				drawPixel(x, y, 1);
+			else
+				drawPixel(x, y, 0);
+		}
+
+	}
+
+}
+
+template<class Storage>
+bool HT1632CanvasBase<Storage>::setGrayBits(byte bits) {
+	if (bits < 1 || bits > 3 || (bits == 3 && !Storage::allocateBuffer3()))
+		return (false);
+	_GRAY_BITS = bits;
+	return (true);
+}
+
+template<class Storage>
+byte HT1632CanvasBase<Storage>::getGrayBits() {
+	return (_GRAY_BITS);
+}
+
+//Not marked dirty, the gray refresh always sends whole planes.
+template<class Storage>
+void HT1632CanvasBase<Storage>::drawPixelGray(int x, int y, byte level) {
+	HT1632Size address;
+	byte mask;
+
+	if (x < 0 || x >= _WIDTH || y < 0 || y >= _HEIGHT)
+		return;
+
+	address = pixelIndex(x, y);
+	mask = pixelMask(x, y);
+	for (byte plane = 0; plane < _GRAY_BITS; plane++, level >>= 1) {
+		if (level & 1)
+			planeBuffer(plane)[address] |= mask;
+		else
+			planeBuffer(plane)[address] &= ~mask;
+	}
+	HT1632_COUNT(_STATS.pixels, 1);
+}
+
+template<class Storage>
+byte HT1632CanvasBase<Storage>::getPixelGray(int x, int y) {
+	HT1632Size address;
+	byte mask;
+	byte level = 0;
+
+	if (x < 0 || x >= _WIDTH || y < 0 || y >= _HEIGHT)
+		return (0);
+
+	address = pixelIndex(x, y);
+	mask = pixelMask(x, y);
+	for (byte plane = 0; plane < _GRAY_BITS; plane++) {
+		if (planeBuffer(plane)[address] & mask)
+			level |= 1 << plane;
+	}
+	return (level);
+}
+
+#undef HT1632_SWAP
+
+#endif
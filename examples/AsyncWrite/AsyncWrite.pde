@@ -0,0 +1,58 @@
+/*
+ * Asynchronous writeScreen. Timer2 interrupt sends the frame in small chunks
+ * while loop() draws the next one and keeps reading the Serial.
+ */
+#include "HT1632C.h"
+
+#define DATA_PIN 5
+#define WR_PIN 4
+#define CS_PIN 6
+
+HT1632Fast<DATA_PIN, WR_PIN, CS_PIN> matrix;
+
+volatile unsigned int frames = 0;
+
+void frameSent() {
+	frames++;
+}
+
+ISR(TIMER2_COMPA_vect) {
+	matrix.writeScreenStep();
+}
+
+void setup() {
+	Serial.begin(115200);
+	matrix.init();
+
+	//Timer2 CTC, 16MHz / 64 / 125 = 2kHz
+	TCCR2A = _BV(WGM21);
+	TCCR2B = _BV(CS22);
+	OCR2A = 124;
+	TIMSK2 = _BV(OCIE2A);
+}
+
+void loop() {
+	static int x = 0;
+	static unsigned long t = 0;
+
+	matrix.clearScreen();
+	matrix.drawLine(x - 1, 1, x - 1, 6, 1);
+	matrix.drawLine(x, 0, x, 7, 1);
+	matrix.drawLine(x + 1, 1, x + 1, 6, 1);
+	x = (x + 1) & 31;
+
+	while (matrix.isBusy())
+		; //Previous frame still on the wire.
+	matrix.beginWriteScreen(frameSent);
+	matrix.swapBuffers(); //Next frame is drawn on the other buffer.
+
+	while (Serial.available())
+		Serial.write(Serial.read()); //Echo, no bytes lost during the refresh.
+
+	if (millis() - t > 1000) {
+		t = millis();
+		Serial.print(frames);
+		Serial.println(" fps");
+		frames = 0;
+	}
+}
@@ -0,0 +1,108 @@
+/*
+ * Speed of the drawing functions and of writeScreen() (HT1632Bench.h) with
+ * the different pin sets. Results are printed over Serial (115200): ops/s or
+ * frames/s and CPU cycles of each. The host build runs the same cases
+ * (ht1632_bench, see CMakeLists.txt). The frames are sent with the
+ * interrupts enabled every 4 bytes (setCriticalSection(4)), so micros()
+ * keeps time: writeScreen() with the default whole frame section is a bit
+ * faster than the frames/s printed.
+ */
+#include "HT1632C.h"
+#include "HT1632Bench.h"
+
+//Uncomment to test the hardware SPI. DATA must be wired to MOSI and WR to SCK.
+//#define SPI_WIRING
+//Uncomment to test 4 chips on lanes: DATA of chip n on pin 8 + n (PORTB bit n
+//on an Uno), CS on 6, 7, A0, A1, WR on 4. Not with SPI_WIRING (pin 11).
+//#define LANES_WIRING
+
+#ifdef SPI_WIRING
+#define DATA_PIN MOSI
+#define WR_PIN SCK
+#else
+#define DATA_PIN 5
+#define WR_PIN 4
+#endif
+#define CS_PIN 6
+
+HT1632 matrix = HT1632(DATA_PIN, WR_PIN, CS_PIN); //Pins in ram
+HT1632Fast<DATA_PIN, WR_PIN, CS_PIN> fastMatrix; //Pins at compile time
+#ifdef SPI_WIRING
+HT1632Spi<CS_PIN> spiMatrix; //Hardware SPI
+#endif
+#ifdef LANES_WIRING
+HT1632Lanes<HT1632FastSelect<6, 7, A0, A1>, 4, 8, 9, 10, 11> lanesMatrix; //A DATA pin per chip
+#endif
+//No display: the drawing alone with more or other modules. The 4 chips need
+//more than the 2 KB of RAM of an Uno.
+HT1632Driver<HT1632MemoryBus<1>, HT1632StaticStorage<HT1632_MODULE_16X24, 1> > memory16x24;
+#if defined(RAMEND) && RAMEND > 0x8FF
+HT1632Driver<HT1632MemoryBus<4>, HT1632StaticStorage<HT1632_MODULE_8X32, 4> > memory4;
+#endif
+
+void setup() {
+	unsigned long t;
+
+	Serial.begin(115200);
+	t = micros();
+	matrix.init();
+	Serial.print("HT1632 init: ");
+	Serial.print(micros() - t);
+	Serial.println(" us");
+	t = micros();
+	fastMatrix.init();
+	Serial.print("HT1632Fast init: ");
+	Serial.print(micros() - t);
+	Serial.println(" us");
+#ifdef SPI_WIRING
+	spiMatrix.init();
+#endif
+#ifdef LANES_WIRING
+	lanesMatrix.init();
+#endif
+	memory16x24.init(0, HT1632_COM_MODULE, HT1632_MODULE_16X24);
+#if defined(RAMEND) && RAMEND > 0x8FF
+	memory4.init();
+#endif
+}
+
+void loop() {
+	//Build it with and without HT1632_WIDE (HT1632C.h) to compare the 8 and
+	//16 bit sizes.
+	Serial.print(sizeof(HT1632Size) * 8);
+	Serial.println(" bit sizes");
+
+	HT1632Bench::run("HT1632", matrix, HT1632_MODULE_8X32, 1);
+	HT1632Bench::run("HT1632Fast", fastMatrix, HT1632_MODULE_8X32, 1);
+#ifdef SPI_WIRING
+	HT1632Bench::run("HT1632Spi", spiMatrix, HT1632_MODULE_8X32, 1);
+#endif
+#ifdef LANES_WIRING
+	HT1632Bench::runLanes("HT1632Lanes, 4 8x32", lanesMatrix, HT1632_MODULE_8X32, 4);
+#endif
+	HT1632Bench::run("HT1632MemoryBus, 1 16x24", memory16x24, HT1632_MODULE_16X24, 1);
+#if defined(RAMEND) && RAMEND > 0x8FF
+	HT1632Bench::run("HT1632MemoryBus, 4 8x32", memory4, HT1632_MODULE_8X32, 4);
+#endif
+
+#ifdef HT1632_STATS
+	//Where the time goes (uncomment HT1632_STATS in HT1632C.h).
+	HT1632Stats stats = fastMatrix.getStats();
+	Serial.print("HT1632Fast: ");
+	Serial.print(stats.frames);
+	Serial.print(" frames, ");
+	Serial.print(stats.bits);
+	Serial.print(" bits, ");
+	Serial.print(stats.selects);
+	Serial.print(" selects, ");
+	Serial.print(stats.pixels);
+	Serial.print(" pixels, last frame ");
+	Serial.print(stats.frameTime);
+	Serial.print(" us, interrupts off ");
+	Serial.print(stats.criticalMax);
+	Serial.println(" us max");
+	fastMatrix.resetStats();
+#endif
+
+	delay(2000);
+}
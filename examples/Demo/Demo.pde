@@ -82,7 +82,7 @@ void loop() {
 			r = 1;
 	}
 
-	//Fast buffer swap test 296 fps
+	//Fast buffer swap test (frame rates: examples/Benchmark)
 	nieve2();
 
 	//Blink test
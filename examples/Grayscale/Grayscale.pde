@@ -0,0 +1,40 @@
+/*
+ * 8 gray levels with bit-planes. Timer2 interrupt calls writeGrayStep(), the
+ * planes are shown 1, 2 and 4 ticks, while loop() draws a moving gradient.
+ */
+#include "HT1632C.h"
+
+#define DATA_PIN 5
+#define WR_PIN 4
+#define CS_PIN 6
+
+HT1632Fast<DATA_PIN, WR_PIN, CS_PIN> matrix;
+
+ISR(TIMER2_COMPA_vect) {
+	matrix.writeGrayStep();
+}
+
+void setup() {
+	matrix.init();
+	//The third plane is malloc'ed, 4 levels if there's no memory for it.
+	if (!matrix.setGrayBits(3))
+		matrix.setGrayBits(2);
+
+	//Timer2 CTC, 16MHz / 64 / 125 = 2kHz, 285 gray cycles per second.
+	TCCR2A = _BV(WGM21);
+	TCCR2B = _BV(CS22);
+	OCR2A = 124;
+	TIMSK2 = _BV(OCIE2A);
+}
+
+void loop() {
+	static byte shift = 0;
+	byte levels = 1 << matrix.getGrayBits();
+
+	for (int x = 0; x < 32; x++) {
+		for (int y = 0; y < 8; y++)
+			matrix.drawPixelGray(x, y, ((x + y + shift) >> 1) & (levels - 1));
+	}
+	shift++;
+	delay(50);
+}
@@ -0,0 +1,59 @@
+/*
+ * Fixed rate refresh. Timer2 interrupt starts a frame every 20 ticks (100 fps)
+ * and sends it in chunks, loop() only draws and calls frameDone(). The
+ * scanner runs at the same speed whatever loop() does, the statistics are
+ * printed over Serial (115200) every second.
+ */
+#include "HT1632C.h"
+
+#define DATA_PIN 5
+#define WR_PIN 4
+#define CS_PIN 6
+
+HT1632Fast<DATA_PIN, WR_PIN, CS_PIN> matrix;
+
+ISR(TIMER2_COMPA_vect) {
+	matrix.refreshStep();
+}
+
+void setup() {
+	Serial.begin(115200);
+	matrix.init();
+
+	//Timer2 CTC, 16MHz / 64 / 125 = 2kHz
+	TCCR2A = _BV(WGM21);
+	TCCR2B = _BV(CS22);
+	OCR2A = 124;
+	TIMSK2 = _BV(OCIE2A);
+
+	matrix.beginRefresh(20);
+}
+
+void loop() {
+	static int x = 0;
+	static unsigned long t = 0;
+	HT1632RefreshStats stats;
+
+	matrix.clearScreen();
+	matrix.drawLine(x - 1, 1, x - 1, 6, 1);
+	matrix.drawLine(x, 0, x, 7, 1);
+	matrix.drawLine(x + 1, 1, x + 1, 6, 1);
+	x = (x + 1) & 31;
+	matrix.frameDone();
+	delay(random(5, 15)); //Uneven loop() work, the frames don't care.
+
+	if (millis() - t > 1000) {
+		t = millis();
+		stats = matrix.getRefreshStats();
+		Serial.print(stats.frames);
+		Serial.print(" frames, ");
+		Serial.print(stats.frameTime);
+		Serial.print(" us/frame, missed ");
+		Serial.print(stats.missed);
+		Serial.print(", dropped ");
+		Serial.print(stats.dropped);
+		Serial.print(", repeated ");
+		Serial.println(stats.repeated);
+		matrix.resetRefreshStats();
+	}
+}
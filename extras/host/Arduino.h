@@ -0,0 +1,119 @@
+/*
+ * HT1632C Driver for Arduino by Luis M. Ruiz - stendall@gmail.com
+ * http://code.google.com/p/ht1632c-driver/
+ * 
+ * Licensed as : CC BY-NC-SA 3.0
+ * For more details see:
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/
+ */
+
+#ifndef HT1632_HOST_ARDUINO_H_h
+#define HT1632_HOST_ARDUINO_H_h
+
+/*
+ * The part of the Arduino core the library uses, for host (PC) builds with
+ * HT1632_HOST (see CMakeLists.txt). The pins are bits in memory and every
+ * write is recorded by HT1632Host, micros() is the real clock.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH		1
+#define LOW			0
+#define INPUT		0
+#define OUTPUT		1
+
+#define F_CPU		16000000UL
+
+#define PROGMEM
+#define pgm_read_byte(p)	(*(const uint8_t *) (p))
+#define _BV(b)		(1 << (b))
+
+#define ISR(vector)	void vector()
+
+#define HT1632_HOST_PINS	64	//8 ports of 8 pins, pin p is bit p & 7 of port p >> 3.
+
+/*
+ * The pins and what happened to them. onWrite is called on every level
+ * change made by digitalWrite() (the port writes of HT1632LanePins aren't
+ * seen, read port[] at the clock edges instead), onRead gives the level of
+ * the input pins.
+ */
+class HT1632Host {
+public:
+	static volatile uint8_t port[HT1632_HOST_PINS / 8];	//Output registers.
+	static uint8_t mode[HT1632_HOST_PINS];		//INPUT/OUTPUT
+	static unsigned long toggles[HT1632_HOST_PINS];	//Level changes of each pin.
+	static unsigned long writes;				//digitalWrite() calls.
+	static bool interrupts;						//false between cli() and sei().
+	static void (*onWrite)(uint8_t pin, uint8_t level);
+	static uint8_t (*onRead)(uint8_t pin);
+
+	static void reset();						//All pins LOW and INPUT, counters to 0. The hooks stay.
+	static inline uint8_t level(uint8_t pin) {
+		return ((port[pin >> 3] >> (pin & 7)) & 1);
+	}
+};
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+#define digitalPinToPort(pin)		((pin) >> 3)
+#define digitalPinToBitMask(pin)	((uint8_t) (1 << ((pin) & 7)))
+#define portOutputRegister(p)		(&HT1632Host::port[p])
+
+inline void cli() {
+	HT1632Host::interrupts = false;
+}
+
+inline void sei() {
+	HT1632Host::interrupts = true;
+}
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+//Timer2, as set by the examples. Nothing runs them.
+extern volatile uint8_t TCCR2A, TCCR2B, OCR2A, TIMSK2;
+#define WGM21		1
+#define CS22		2
+#define OCIE2A		1
+
+//Serial prints to stdout.
+class HT1632HostSerial {
+public:
+	void begin(unsigned long baud);
+	int available();
+	int read();
+	void write(uint8_t c);
+	void print(const char * s);
+	void print(char c);
+	void print(int n);
+	void print(unsigned int n);
+	void print(long n);
+	void print(unsigned long n);
+	void print(double n, int digits = 2);
+	template<typename T>
+	void println(T value) {
+		print(value);
+		println();
+	}
+	void println();
+};
+extern HT1632HostSerial Serial;
+
+#endif
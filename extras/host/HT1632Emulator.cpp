@@ -0,0 +1,274 @@
+/*
+ * HT1632C Driver for Arduino by Luis M. Ruiz - stendall@gmail.com
+ * http://code.google.com/p/ht1632c-driver/
+ * 
+ * Licensed as : CC BY-NC-SA 3.0
+ * For more details see:
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/
+ */
+
+#include "HT1632Emulator.h"
+
+HT1632Emulator * HT1632Emulator::_ACTIVE = NULL;
+
+HT1632Emulator::HT1632Emulator() {
+	_CHIPS = 0;
+	_DATA = 0;
+	_WCLOCK = 0;
+	_RCLOCK = 0;
+	_CSDATA = 0;
+	_CSCLOCK = 0;
+	memset((void *) state, 0, sizeof(state));
+	memset((void *) _CHIP, 0, sizeof(_CHIP));
+	resetStats();
+}
+
+void HT1632Emulator::begin(byte chips, byte data, byte wclock, byte rclock) {
+	if (chips > HT1632_EMULATOR_CHIPS)
+		chips = HT1632_EMULATOR_CHIPS;
+	_CHIPS = chips;
+	_DATA = data;
+	_WCLOCK = wclock;
+	_RCLOCK = rclock;
+	_CSDATA = 0;
+	_CSCLOCK = 0;
+	_CHAIN = 0xFFFF; //The driver constructor already released all the chips.
+	memset((void *) state, 0, sizeof(state));
+	for (byte chip = 0; chip < HT1632_EMULATOR_CHIPS; chip++) {
+		_CHIP[chip].cs = 0;
+		_CHIP[chip].data = data;
+		_CHIP[chip].selected = false;
+		_CHIP[chip].phase = IDLE;
+	}
+	resetStats();
+	_ACTIVE = this;
+	HT1632Host::onWrite = pinWrite;
+	HT1632Host::onRead = pinRead;
+}
+
+void HT1632Emulator::end() {
+	if (_ACTIVE == this) {
+		HT1632Host::onWrite = NULL;
+		HT1632Host::onRead = NULL;
+		_ACTIVE = NULL;
+	}
+}
+
+void HT1632Emulator::chipPin(byte chip, byte cs) {
+	_CHIP[chip].cs = cs;
+	updateSelects();
+}
+
+void HT1632Emulator::dataPin(byte chip, byte data) {
+	_CHIP[chip].data = data;
+}
+
+void HT1632Emulator::shiftSelect(byte csdata, byte csclock) {
+	_CSDATA = csdata;
+	_CSCLOCK = csclock;
+	updateSelects();
+}
+
+void HT1632Emulator::resetStats() {
+	memset((void *) &stats, 0, sizeof(stats));
+	_WIRE_CLOCKS = 0;
+	_LAST_CLOCKS = 0;
+}
+
+unsigned long HT1632Emulator::lastClocks() {
+	return (_LAST_CLOCKS);
+}
+
+void HT1632Emulator::pinWrite(byte pin, byte level) {
+	if (_ACTIVE)
+		_ACTIVE->write(pin, level);
+}
+
+byte HT1632Emulator::pinRead(byte pin) {
+	return (_ACTIVE ? _ACTIVE->read(pin) : LOW);
+}
+
+void HT1632Emulator::write(byte pin, byte level) {
+	bool clocked = false;
+
+	if (_CSCLOCK && pin == _CSCLOCK) {
+		if (level == HIGH) {
+			//74HC164: output 0 takes the serial input, the others the previous output.
+			_CHAIN = (_CHAIN << 1) | HT1632Host::level(_CSDATA);
+			updateSelects();
+		}
+	} else if (pin == _WCLOCK) {
+		if (level == HIGH) {
+			for (byte chip = 0; chip < _CHIPS; chip++) {
+				if (_CHIP[chip].selected) {
+					clock(_CHIP[chip], HT1632Host::level(_CHIP[chip].data));
+					clocked = true;
+				}
+			}
+			if (clocked) {
+				stats.wclocks++;
+				_WIRE_CLOCKS++;
+			}
+		}
+	} else if (_RCLOCK && pin == _RCLOCK) {
+		if (level == LOW) {
+			for (byte chip = 0; chip < _CHIPS; chip++) {
+				if (_CHIP[chip].selected) {
+					readClock(_CHIP[chip]);
+					clocked = true;
+				}
+			}
+			if (clocked) {
+				stats.rclocks++;
+				_WIRE_CLOCKS++;
+			}
+		}
+	} else {
+		updateSelects();
+	}
+}
+
+//The chips drive DATA only while they are being read.
+byte HT1632Emulator::read(byte pin) {
+	for (byte chip = 0; chip < _CHIPS; chip++) {
+		Chip & c = _CHIP[chip];
+		if (c.selected && c.data == pin && (c.phase == READ || c.phase == WRITE))
+			return (c.outLevel);
+	}
+	return (LOW);
+}
+
+void HT1632Emulator::updateSelects() {
+	bool selected[HT1632_EMULATOR_CHIPS];
+	bool changed = false;
+
+	for (byte chip = 0; chip < _CHIPS; chip++) {
+		if (_CHIP[chip].cs)
+			selected[chip] = HT1632Host::level(_CHIP[chip].cs) == LOW;
+		else if (_CSCLOCK)
+			selected[chip] = ((_CHAIN >> chip) & 1) == 0;
+		else
+			selected[chip] = false;
+		if (selected[chip] != _CHIP[chip].selected)
+			changed = true;
+	}
+	if (!changed)
+		return;
+
+	finish();
+	for (byte chip = 0; chip < _CHIPS; chip++) {
+		if (selected[chip] && !_CHIP[chip].selected)
+			select(_CHIP[chip]);
+		else if (!selected[chip] && _CHIP[chip].selected)
+			release(_CHIP[chip]);
+	}
+}
+
+//The set of selected chips changes: the transaction on the wire ends.
+void HT1632Emulator::finish() {
+	if (_WIRE_CLOCKS == 0)
+		return;
+	for (byte chip = 0; chip < _CHIPS; chip++) {
+		if (_CHIP[chip].selected) {
+			if (_CHIP[chip].id == 4)
+				stats.commandClocks += _WIRE_CLOCKS;
+			else if (_CHIP[chip].id == 5)
+				stats.writeClocks += _WIRE_CLOCKS;
+			else if (_CHIP[chip].id == 6)
+				stats.readClocks += _WIRE_CLOCKS;
+			break;
+		}
+	}
+	stats.transactions++;
+	_LAST_CLOCKS = _WIRE_CLOCKS;
+	_WIRE_CLOCKS = 0;
+}
+
+void HT1632Emulator::select(Chip & chip) {
+	chip.selected = true;
+	chip.phase = ID;
+	chip.id = 0;
+	chip.bits = 0;
+	chip.count = 0;
+	chip.outBits = 0;
+	chip.outLevel = LOW;
+}
+
+void HT1632Emulator::release(Chip & chip) {
+	chip.selected = false;
+	chip.phase = IDLE;
+}
+
+//WR rising edge, the chip takes DATA.
+void HT1632Emulator::clock(Chip & chip, byte bit) {
+	HT1632ChipState & s = state[&chip - _CHIP];
+
+	switch (chip.phase) {
+	case ID:
+		chip.id = (chip.id << 1) | bit;
+		if (++chip.bits == 3) {
+			if (chip.id == 4)
+				chip.phase = COMMAND;
+			else if (chip.id == 5 || chip.id == 6)
+				chip.phase = ADDRESS;
+			else
+				chip.phase = IGNORE;
+			chip.bits = 0;
+			chip.count = 0;
+		}
+		break;
+	case COMMAND:
+		//8 bits of command and 1 that doesn't matter, as many as sent.
+		if (++chip.bits <= 8)
+			chip.count = (chip.count << 1) | bit;
+		if (chip.bits == 8) {
+			s.execute(chip.count);
+			stats.commands++;
+		} else if (chip.bits == 9) {
+			chip.bits = 0;
+			chip.count = 0;
+		}
+		break;
+	case ADDRESS:
+		chip.count = (chip.count << 1) | bit;
+		if (++chip.bits == 7) {
+			chip.address = chip.count & 0x7F;
+			chip.phase = (chip.id == 6) ? READ : WRITE;
+			chip.bits = 0;
+			chip.count = 0;
+		}
+		break;
+	case WRITE:
+		chip.count = (chip.count << 1) | bit;
+		if (++chip.bits == 4) {
+			if (chip.address < HT1632_RAM_SIZE)
+				s.ram[chip.address] = chip.count & 0x0F;
+			stats.nibbles++;
+			chip.address = (chip.address + 1) & 0x7F; //7 bit address counter
+			chip.bits = 0;
+			chip.count = 0;
+			chip.outBits = 0;
+		}
+		break;
+	}
+}
+
+/*
+ * RD falling edge, the chip puts the next bit of the nibble on DATA. In a
+ * write (read-modify-write) the address stays, the next nibble written goes
+ * to the one just read.
+ */
+void HT1632Emulator::readClock(Chip & chip) {
+	HT1632ChipState & s = state[&chip - _CHIP];
+
+	if (chip.phase != READ && !(chip.phase == WRITE && chip.bits == 0))
+		return;
+	if (chip.outBits == 0)
+		chip.out = (chip.address < HT1632_RAM_SIZE) ? s.ram[chip.address] : 0;
+	chip.outLevel = (chip.out >> (3 - chip.outBits)) & 1;
+	if (++chip.outBits == 4) {
+		chip.outBits = 0;
+		if (chip.phase == READ)
+			chip.address = (chip.address + 1) & 0x7F;
+	}
+}
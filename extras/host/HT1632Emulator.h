@@ -0,0 +1,100 @@
+/*
+ * HT1632C Driver for Arduino by Luis M. Ruiz - stendall@gmail.com
+ * http://code.google.com/p/ht1632c-driver/
+ * 
+ * Licensed as : CC BY-NC-SA 3.0
+ * For more details see:
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/
+ */
+
+#ifndef HT1632EMULATOR_H_h
+#define HT1632EMULATOR_H_h
+
+#include "HT1632C.h"
+
+/*
+ * HT1632C chips on the host pins (HT1632Host). They follow the CS, WR, RD
+ * and DATA levels written by the library, as the real chips would, and
+ * decode the protocol: ids, commands, addresses, successive writes, reads
+ * and read-modify-writes. The result is a HT1632ChipState per chip, the same
+ * that HT1632MemoryBus keeps, so a pin set can be checked bit by bit against
+ * it. The clocks of every transaction are counted.
+ *
+ * Wiring: a DATA line shared by all the chips (or one per chip, lanes), a
+ * WR and an optional RD. The chip selects are pins (chipPin()) or the
+ * outputs of a 74HC164 chain (shiftSelect()).
+ * Only one emulator listens to the pins at a time, the last begin().
+ * The SPI of the host build doesn't touch the pins, it can't be emulated.
+ */
+#define HT1632_EMULATOR_CHIPS	16
+
+//Wire clocks, by kind of transaction.
+struct HT1632EmulatorStats {
+	unsigned long transactions;	//Chip select low periods with clocks.
+	unsigned long wclocks;		//WR rising edges with a chip selected.
+	unsigned long rclocks;		//RD falling edges with a chip selected.
+	unsigned long commandClocks;	//Clocks in command (100) transactions.
+	unsigned long writeClocks;	//In write and read-modify-write (101).
+	unsigned long readClocks;	//In read (110).
+	unsigned long commands;		//Commands executed (per chip).
+	unsigned long nibbles;		//Nibbles written (per chip).
+};
+
+class HT1632Emulator {
+public:
+	HT1632ChipState state[HT1632_EMULATOR_CHIPS];
+	HT1632EmulatorStats stats;
+
+	HT1632Emulator();
+	void begin(byte chips, byte data, byte wclock, byte rclock = 0);	//Resets the chips and listens to the pins.
+	void end();
+	void chipPin(byte chip, byte cs);		//CS of 'chip' on a pin.
+	void dataPin(byte chip, byte data);		//DATA of 'chip', if not the shared one (lanes).
+	void shiftSelect(byte csdata, byte csclock);	//CS of chip n on output n of a 74HC164 chain.
+	void resetStats();
+	unsigned long lastClocks();				//Clocks of the last finished transaction.
+
+private:
+	enum Phase {
+		IDLE, ID, COMMAND, ADDRESS, WRITE, READ, IGNORE
+	};
+	struct Chip {
+		byte cs;
+		byte data;
+		bool selected;
+		byte phase;
+		byte id;
+		byte bits;		//Bits shifted in the current field.
+		byte count;
+		byte address;
+		byte out;		//Nibble being read.
+		byte outBits;	//Bits of it already out.
+		byte outLevel;	//DATA driven by the chip.
+		unsigned long clocks;
+	};
+
+	static HT1632Emulator * _ACTIVE;
+	byte _CHIPS;
+	byte _DATA;
+	byte _WCLOCK;
+	byte _RCLOCK;
+	byte _CSDATA;
+	byte _CSCLOCK;
+	unsigned int _CHAIN; //74HC164 outputs, bit n = output n.
+	unsigned long _WIRE_CLOCKS; //Of the transaction on the wire.
+	unsigned long _LAST_CLOCKS;
+	Chip _CHIP[HT1632_EMULATOR_CHIPS];
+
+	static void pinWrite(byte pin, byte level);
+	static byte pinRead(byte pin);
+	void write(byte pin, byte level);
+	byte read(byte pin);
+	void updateSelects();
+	void finish();
+	void select(Chip & chip);
+	void release(Chip & chip);
+	void clock(Chip & chip, byte bit);
+	void readClock(Chip & chip);
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * HT1632C Driver for Arduino by Luis M. Ruiz - stendall@gmail.com
+ * http://code.google.com/p/ht1632c-driver/
+ * 
+ * Licensed as : CC BY-NC-SA 3.0
+ * For more details see:
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "Arduino.h"
+
+volatile uint8_t HT1632Host::port[HT1632_HOST_PINS / 8];
+uint8_t HT1632Host::mode[HT1632_HOST_PINS];
+unsigned long HT1632Host::toggles[HT1632_HOST_PINS];
+unsigned long HT1632Host::writes = 0;
+bool HT1632Host::interrupts = true;
+void (*HT1632Host::onWrite)(uint8_t pin, uint8_t level) = NULL;
+uint8_t (*HT1632Host::onRead)(uint8_t pin) = NULL;
+
+volatile uint8_t TCCR2A, TCCR2B, OCR2A, TIMSK2;
+
+HT1632HostSerial Serial;
+
+void HT1632Host::reset() {
+	memset((void *) port, 0, sizeof(port));
+	memset((void *) mode, INPUT, sizeof(mode));
+	memset((void *) toggles, 0, sizeof(toggles));
+	writes = 0;
+	interrupts = true;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	if (pin < HT1632_HOST_PINS)
+		HT1632Host::mode[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+	uint8_t mask = digitalPinToBitMask(pin);
+	volatile uint8_t * reg;
+
+	if (pin >= HT1632_HOST_PINS)
+		return;
+	HT1632Host::writes++;
+	if (HT1632Host::level(pin) == (level ? 1 : 0))
+		return;
+	reg = portOutputRegister(digitalPinToPort(pin));
+	if (level)
+		*reg |= mask;
+	else
+		*reg &= ~mask;
+	HT1632Host::toggles[pin]++;
+	if (HT1632Host::onWrite)
+		HT1632Host::onWrite(pin, level ? HIGH : LOW);
+}
+
+//Outputs read back their level, inputs ask onRead.
+int digitalRead(uint8_t pin) {
+	if (pin >= HT1632_HOST_PINS)
+		return (LOW);
+	if (HT1632Host::mode[pin] == OUTPUT)
+		return (HT1632Host::level(pin));
+	return (HT1632Host::onRead ? HT1632Host::onRead(pin) : LOW);
+}
+
+int analogRead(uint8_t /* pin */) {
+	return (rand() & 0x3FF);
+}
+
+static unsigned long long hostNanos() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+static const unsigned long long hostStart = hostNanos();
+
+unsigned long micros() {
+	return ((unsigned long) ((hostNanos() - hostStart) / 1000));
+}
+
+unsigned long millis() {
+	return ((unsigned long) ((hostNanos() - hostStart) / 1000000));
+}
+
+void delay(unsigned long ms) {
+	struct timespec wait = { (time_t) (ms / 1000), (long) (ms % 1000) * 1000000L };
+
+	nanosleep(&wait, NULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+	//Busy, as in the board. Short enough to not matter in the benchmarks.
+	unsigned long long end = hostNanos() + us * 1000ULL;
+
+	while (hostNanos() < end)
+		;
+}
+
+long random(long howbig) {
+	return (howbig > 0 ? rand() % howbig : 0);
+}
+
+long random(long howsmall, long howbig) {
+	return (howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall));
+}
+
+void randomSeed(unsigned long seed) {
+	srand(seed);
+}
+
+void HT1632HostSerial::begin(unsigned long /* baud */) {
+}
+
+int HT1632HostSerial::available() {
+	return (0);
+}
+
+int HT1632HostSerial::read() {
+	return (-1);
+}
+
+void HT1632HostSerial::write(uint8_t c) {
+	putchar(c);
+}
+
+void HT1632HostSerial::print(const char * s) {
+	fputs(s, stdout);
+}
+
+void HT1632HostSerial::print(char c) {
+	putchar(c);
+}
+
+void HT1632HostSerial::print(int n) {
+	printf("%d", n);
+}
+
+void HT1632HostSerial::print(unsigned int n) {
+	printf("%u", n);
+}
+
+void HT1632HostSerial::print(long n) {
+	printf("%ld", n);
+}
+
+void HT1632HostSerial::print(unsigned long n) {
+	printf("%lu", n);
+}
+
+void HT1632HostSerial::print(double n, int digits) {
+	printf("%.*f", digits, n);
+}
+
+void HT1632HostSerial::println() {
+	putchar('\n');
+}
@@ -0,0 +1,179 @@
+/*
+ * HT1632C Driver for Arduino by Luis M. Ruiz - stendall@gmail.com
+ * http://code.google.com/p/ht1632c-driver/
+ *
+ * Licensed as : CC BY-NC-SA 3.0
+ * For more details see:
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/
+ */
+
+#include "HT1632Vcd.h"
+
+HT1632VcdCost HT1632Vcd::cost = { F_CPU, 2, 5, 8, 16 };
+HT1632VcdTiming HT1632Vcd::timing;
+FILE * HT1632Vcd::_FILE = NULL;
+byte HT1632Vcd::_CHIPS = 0;
+unsigned long long HT1632Vcd::_CYCLES = 0;
+unsigned long long HT1632Vcd::_LAST_TIME = 0;
+byte HT1632Vcd::_LEVEL[HT1632_VCD_CS + HT1632_VCD_CHIPS];
+byte HT1632Vcd::_SELECTED = 0;
+bool HT1632Vcd::_CLOCKED = false;
+unsigned long long HT1632Vcd::_WR_RISE = 0;
+unsigned long long HT1632Vcd::_WR_FALL = 0;
+unsigned long long HT1632Vcd::_DATA_CHANGE = 0;
+
+static const char * const vcdNames[] = { "WR", "RD", "DATA" };
+static const char vcdLevels[] = { '0', '1', 'z' };
+
+//Identifier of a signal in the file.
+static inline char vcdId(byte signal) {
+	return ('!' + signal);
+}
+
+bool HT1632Vcd::open(const char * path, byte chips) {
+	close();
+	_FILE = fopen(path, "w");
+	if (!_FILE)
+		return (false);
+	if (chips > HT1632_VCD_CHIPS)
+		chips = HT1632_VCD_CHIPS;
+	_CHIPS = chips;
+	_CYCLES = 0;
+	_LAST_TIME = 0;
+	_SELECTED = 0;
+	_CLOCKED = false;
+	_WR_RISE = _WR_FALL = _DATA_CHANGE = 0;
+	resetTiming();
+
+	fprintf(_FILE, "$comment HT1632C bus, %lu Hz, cycles: pin write %d, bit loop %d,"
+			" call %d, read delay %d $end\n", cost.hz, cost.pinWrite, cost.bitLoop,
+			cost.call, cost.readDelay);
+	fprintf(_FILE, "$timescale 1ns $end\n$scope module ht1632 $end\n");
+	for (byte signal = 0; signal < HT1632_VCD_CS + chips; signal++) {
+		if (signal < HT1632_VCD_CS)
+			fprintf(_FILE, "$var wire 1 %c %s $end\n", vcdId(signal), vcdNames[signal]);
+		else
+			fprintf(_FILE, "$var wire 1 %c CS%d $end\n", vcdId(signal),
+					signal - HT1632_VCD_CS);
+	}
+	fprintf(_FILE, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+	//Idle bus: all released, WR and RD high.
+	for (byte signal = 0; signal < HT1632_VCD_CS + chips; signal++) {
+		_LEVEL[signal] = signal == HT1632_VCD_DATA ? LOW : HIGH;
+		fprintf(_FILE, "%c%c\n", vcdLevels[_LEVEL[signal]], vcdId(signal));
+	}
+	fprintf(_FILE, "$end\n");
+	return (true);
+}
+
+void HT1632Vcd::close() {
+	if (_FILE) {
+		if (_CYCLES != _LAST_TIME)
+			fprintf(_FILE, "#%lu\n", nanos(_CYCLES)); //The end of the last step.
+		fclose(_FILE);
+		_FILE = NULL;
+	}
+}
+
+void HT1632Vcd::resetTiming() {
+	memset(&timing, 0, sizeof(timing));
+	timing.minPeriod = timing.minLow = timing.minHigh = timing.minSetup = ~0UL;
+}
+
+unsigned long long HT1632Vcd::cycles() {
+	return (_CYCLES);
+}
+
+unsigned long HT1632Vcd::nanos(unsigned long long cycles) {
+	return ((unsigned long) (cycles * 1000000000ULL / cost.hz));
+}
+
+void HT1632Vcd::select(byte chip, byte level) {
+	_CYCLES += cost.call;
+	if (chip == HT1632_ALL_CHIPS) {
+		for (chip = 0; chip < _CHIPS; chip++)
+			pin(HT1632_VCD_CS + chip, level);
+	} else if (chip < _CHIPS) {
+		pin(HT1632_VCD_CS + chip, level);
+	}
+}
+
+//The loop of HT1632FastWire::writeBits().
+void HT1632Vcd::writeBits(byte bits, byte mask) {
+	_CYCLES += cost.call;
+	while (mask) {
+		pin(HT1632_VCD_WR, LOW);
+		pin(HT1632_VCD_DATA, bits & mask ? HIGH : LOW);
+		pin(HT1632_VCD_WR, HIGH);
+		_CYCLES += cost.bitLoop;
+		mask >>= 1;
+	}
+}
+
+//And HT1632FastWire::readBits(), the chip drives DATA.
+byte HT1632Vcd::readBits(byte mask) {
+	byte data = _LEVEL[HT1632_VCD_DATA];
+
+	_CYCLES += cost.call;
+	change(HT1632_VCD_DATA, HT1632_VCD_Z);
+	while (mask) {
+		pin(HT1632_VCD_RD, LOW);
+		_CYCLES += cost.readDelay;
+		pin(HT1632_VCD_RD, HIGH);
+		_CYCLES += cost.bitLoop;
+		mask >>= 1;
+	}
+	change(HT1632_VCD_DATA, data);
+	return (0);
+}
+
+//A pin write: the change, if any, and its cycles.
+void HT1632Vcd::pin(byte signal, byte level) {
+	change(signal, level);
+	_CYCLES += cost.pinWrite;
+}
+
+void HT1632Vcd::change(byte signal, byte level) {
+	if (_LEVEL[signal] == level)
+		return;
+	_LEVEL[signal] = level;
+
+	if (signal >= HT1632_VCD_CS) {
+		if (level == LOW) {
+			if (_SELECTED++ == 0) {
+				timing.selects++;
+				_CLOCKED = false;
+				_WR_RISE = 0;
+			}
+		} else if (--_SELECTED == 0 && !_CLOCKED) {
+			timing.emptySelects++;
+		}
+	} else if (signal == HT1632_VCD_DATA) {
+		_DATA_CHANGE = _CYCLES;
+	} else if (_SELECTED && signal == HT1632_VCD_WR) {
+		if (level == LOW) {
+			if (_WR_RISE)
+				minimum(timing.minHigh, _CYCLES - _WR_RISE);
+			_WR_FALL = _CYCLES;
+		} else {
+			timing.clocks++;
+			_CLOCKED = true;
+			minimum(timing.minLow, _CYCLES - _WR_FALL);
+			minimum(timing.minSetup, _CYCLES - _DATA_CHANGE);
+			if (_WR_RISE)
+				minimum(timing.minPeriod, _CYCLES - _WR_RISE);
+			_WR_RISE = _CYCLES;
+		}
+	} else if (_SELECTED && signal == HT1632_VCD_RD && level == LOW) {
+		timing.rclocks++;
+		_CLOCKED = true;
+	}
+
+	if (!_FILE)
+		return;
+	if (_CYCLES != _LAST_TIME) {
+		fprintf(_FILE, "#%lu\n", nanos(_CYCLES));
+		_LAST_TIME = _CYCLES;
+	}
+	fprintf(_FILE, "%c%c\n", vcdLevels[level], vcdId(signal));
+}
@@ -0,0 +1,120 @@
+/*
+ * HT1632C Driver for Arduino by Luis M. Ruiz - stendall@gmail.com
+ * http://code.google.com/p/ht1632c-driver/
+ *
+ * Licensed as : CC BY-NC-SA 3.0
+ * For more details see:
+ * http://creativecommons.org/licenses/by-nc-sa/3.0/
+ */
+
+#ifndef HT1632VCD_H_h
+#define HT1632VCD_H_h
+
+#include <stdio.h>
+#include "HT1632C.h"
+
+/*
+ * Waveforms of the bus in a Value Change Dump file (GTKWave, ...).
+ * HT1632VcdPins is a pin set that moves CS, WR, RD and DATA the way the
+ * bitbang pin sets do, and HT1632Vcd writes every change with the time it
+ * would have on the board. The time comes from HT1632VcdCost, the cycles of
+ * each step of the loops: the defaults are HT1632FastPins on a 16 MHz AVR,
+ * raise pinWrite (about 50) for digitalWrite(), HT1632Pins.
+ *
+ *   HT1632Driver<HT1632Bus<HT1632VcdPins<2> > > matrix;
+ *   HT1632Vcd::open("bus.vcd", 2);
+ *   matrix.init();
+ *   ...
+ *   HT1632Vcd::close();
+ *
+ * HT1632Vcd::timing has the narrowest WR pulses, the shortest DATA setup
+ * before WR rises and the chip selects that clocked nothing, to compare
+ * with the HT1632C datasheet before making the loops faster.
+ * The chips aren't emulated: DATA is 'z' while reading, readBits() gives 0.
+ */
+#define HT1632_VCD_CHIPS		16
+#define HT1632_VCD_WR			0	//Signals: WR, RD, DATA, CS0...
+#define HT1632_VCD_RD			1
+#define HT1632_VCD_DATA			2
+#define HT1632_VCD_CS			3
+#define HT1632_VCD_Z			2	//DATA level while the chip drives it.
+
+//Cycles of each step, at 'hz'.
+struct HT1632VcdCost {
+	unsigned long hz;		//CPU clock.
+	byte pinWrite;			//A pin write, changed or not (sbi/cbi: 2).
+	byte bitLoop;			//Rest of the loop, per bit (test, shift, branch).
+	byte call;				//Call and return of chipSelect, writeBits, ...
+	byte readDelay;			//RD low to the DATA sample (HT1632_READ_DELAY).
+};
+
+//Narrowest timings seen while a chip was selected, in cycles (~0: none).
+struct HT1632VcdTiming {
+	unsigned long clocks;		//WR rising edges.
+	unsigned long rclocks;		//RD falling edges.
+	unsigned long selects;		//Periods with some CS low.
+	unsigned long emptySelects;	//Of them, without any clock: redundant.
+	unsigned long minPeriod;	//WR rising to WR rising (tCLK).
+	unsigned long minLow;		//WR low.
+	unsigned long minHigh;		//WR high.
+	unsigned long minSetup;		//DATA change to WR rising (tSU).
+};
+
+class HT1632Vcd {
+public:
+	static HT1632VcdCost cost;
+	static HT1632VcdTiming timing;
+
+	static bool open(const char * path, byte chips);	//false if the file can't be created.
+	static void close();
+	static void resetTiming();
+	static unsigned long long cycles();			//Time since open().
+	static unsigned long nanos(unsigned long long cycles);
+
+	//The pin set.
+	static void select(byte chip, byte level);
+	static void writeBits(byte bits, byte mask);
+	static byte readBits(byte mask);
+
+private:
+	static FILE * _FILE;
+	static byte _CHIPS;
+	static unsigned long long _CYCLES;
+	static unsigned long long _LAST_TIME;	//Of the last '#' written.
+	static byte _LEVEL[HT1632_VCD_CS + HT1632_VCD_CHIPS];
+	static byte _SELECTED;				//CS lines low.
+	static bool _CLOCKED;				//Clocks in this select period.
+	static unsigned long long _WR_RISE, _WR_FALL, _DATA_CHANGE;
+
+	static void pin(byte signal, byte level);
+	static void change(byte signal, byte level);
+	static inline void minimum(unsigned long & value, unsigned long long cycles) {
+		if (cycles < value)
+			value = cycles;
+	}
+};
+
+template<byte CHIPS = 1>
+class HT1632VcdPins {
+public:
+	byte chips() {
+		return (CHIPS);
+	}
+	void chipSelect(byte chip) {
+		HT1632Vcd::select(chip, LOW);
+	}
+	void chipRelease(byte chip) {
+		HT1632Vcd::select(chip, HIGH);
+	}
+	void writeBits(byte bits, byte mask) {
+		HT1632Vcd::writeBits(bits, mask);
+	}
+	bool canRead() {
+		return (true);
+	}
+	byte readBits(byte mask) {
+		return (HT1632Vcd::readBits(mask));
+	}
+};
+
+#endif
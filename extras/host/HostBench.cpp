@@ -0,0 +1,356 @@
+/*
+ * Drawing and frame dump cost on the host (see CMakeLists.txt), the
+ * HT1632Bench cases of examples/Benchmark. HT1632MemoryBus times the library
+ * alone for the module types and chip counts, HT1632Fast the bitbang on the
+ * recorded pins and HT1632Lanes writeScreen() against writeScreenLanes().
+ *
+ * ht1632_bench --verify runs every pin set against emulated chips
+ * (HT1632Emulator) and checks them bit by bit against HT1632MemoryBus,
+ * with the wire clocks of a frame. HT1632Spi is checked on HT1632Trace.
+ * The arranged cases check the rotated mapping, the static storage one
+ * against the tables of the heap.
+ *
+ * ht1632_bench --vcd bus.vcd writes the waveforms of init(), a whole frame,
+ * a 1 pixel frame and a drawPixelDirect() (HT1632Vcd), for GTKWave, and
+ * prints the selects and the narrowest pulses of each.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "HT1632C.h"
+#include "HT1632Bench.h"
+#include "HT1632Emulator.h"
+#include "HT1632Vcd.h"
+
+#define DATA_PIN 5
+#define WR_PIN 4
+#define RD_PIN 7
+#define CS_PIN 6
+#define CS1_PIN 8
+#define CS2_PIN 9
+#define CS3_PIN 10
+#define CSDATA_PIN 11
+#define CSCLOCK_PIN 12
+#define LANE0_PIN 16	//Lanes in port 2.
+#define LANE1_PIN 17
+#define LANE2_PIN 18
+#define LANE3_PIN 19
+#define LANE_WR_PIN 20	//WR in the lanes port.
+
+//writeScreenLanes() only exists on the lane buses, the reference uses writeScreen().
+template<bool LANES> struct Send {
+	template<class Matrix> static void frame(Matrix & matrix) {
+		matrix.writeScreen();
+	}
+};
+
+template<> struct Send<true> {
+	template<class Matrix> static void frame(Matrix & matrix) {
+		matrix.writeScreenLanes();
+	}
+};
+
+/*
+ * The same frames for the pin set and the reference: commands, a full and a
+ * dirty writeScreen (or writeScreenLanes), an asynchronous one and two
+ * drawPixelDirect(): read-modify-writes if the pin set 'reads', writes from
+ * the buffer if not, then verifyScreen() must fail. 'plain' calls init()
+ * without arguments, the module must come from the storage. 'columns' > 0
+ * arranges the panels in a grid with 'rotations' after init().
+ */
+template<bool LANES, class Matrix>
+bool script(Matrix & matrix, byte module, bool reads, bool plain = false,
+		byte columns = 0, const byte * rotations = NULL) {
+	bool ok = true;
+
+	if (plain)
+		matrix.init();
+	else
+		matrix.init(0, HT1632_COM_MODULE, module);
+	if (columns && !matrix.arrange(columns, rotations))
+		return (false);
+	matrix.setBrightness(9, HT1632_ALL_CHIPS);
+	matrix.blinkMode(true, 0);
+	srand(7);
+	for (int i = 0; i < 300; i++)
+		matrix.drawPixel(rand() % 64, rand() % 64, rand() & 1);
+	Send<LANES>::frame(matrix);
+	for (int i = 0; i < 5; i++)
+		matrix.drawPixel(rand() % 64, rand() % 64, rand() & 1);
+	Send<LANES>::frame(matrix);
+
+	matrix.setActiveBuffer(1);
+	matrix.drawString(0, 1, "Emu", 1);
+	matrix.beginWriteScreen();
+	while (matrix.writeScreenStep())
+		;
+	matrix.drawPixelDirect(0, 3, 1); //In the "E", its nibble has other pixels on.
+	matrix.drawPixelDirect(1, 1, 0);
+	ok = matrix.verifyScreen() == reads;
+	return (ok);
+}
+
+template<class Reference>
+bool sameChips(HT1632Emulator & emulator, Reference & reference, byte chips) {
+	for (byte chip = 0; chip < chips; chip++) {
+		HT1632ChipState & a = emulator.state[chip];
+		HT1632ChipState & b = reference.bus().state[chip];
+		if (memcmp(a.ram, b.ram, sizeof(a.ram)) || a.com != b.com
+				|| a.pwm != b.pwm || a.system != b.system || a.led != b.led
+				|| a.blink != b.blink || a.master != b.master)
+			return (false);
+	}
+	return (true);
+}
+
+//Runs the script in both, then times a whole frame and a 1 pixel frame in clocks.
+template<byte CHIPS, bool LANES, class Matrix, class Reference>
+bool verify(const char * name, Matrix & matrix, Reference & reference,
+		HT1632Emulator & emulator, byte module, bool reads, bool plain = false,
+		byte columns = 0, const byte * rotations = NULL) {
+	unsigned long full, pixel;
+	bool ok;
+
+	ok = script<LANES>(matrix, module, reads, plain, columns, rotations);
+	ok = script<false>(reference, module, true, false, columns, rotations) && ok;
+	ok = ok && sameChips(emulator, reference, CHIPS); //Before the frames below hide the direct writes.
+
+	emulator.resetStats();
+	matrix.setActiveBuffer(0); //Not the last one sent, so the whole screen.
+	Send<LANES>::frame(matrix);
+	full = emulator.stats.wclocks;
+	matrix.drawPixel(1, 1, 1);
+	Send<LANES>::frame(matrix);
+	pixel = emulator.stats.wclocks - full;
+	reference.setActiveBuffer(0);
+	reference.writeScreen();
+	reference.drawPixel(1, 1, 1);
+	reference.writeScreen();
+
+	ok = ok && sameChips(emulator, reference, CHIPS);
+	emulator.end();
+	printf("%-28s %s  frame %5lu clocks, 1 pixel %3lu clocks\n", name,
+			ok ? "ok  " : "FAIL", full, pixel);
+	return (ok);
+}
+
+/*
+ * HT1632Spi doesn't move the host pins, its bit stream (SPI bytes and the
+ * bitbanged fields) goes to HT1632Trace. It must be the one of the bitbang.
+ */
+bool verifySpi() {
+	static char spi[HT1632_TRACE_SIZE + 1];
+	HT1632Spi<CS_PIN, CS1_PIN> matrix;
+	HT1632Driver<HT1632Bus<HT1632TracePins<2> > > reference;
+	unsigned int bytes;
+	bool ok;
+
+	HT1632Trace::clear();
+	script<false>(matrix, HT1632_MODULE_8X32, false);
+	bytes = HT1632Trace::bytes;
+	memcpy(spi, HT1632Trace::log, HT1632Trace::length + 1);
+	HT1632Trace::clear();
+	script<false>(reference, HT1632_MODULE_8X32, false);
+	ok = bytes && HT1632Trace::length < HT1632_TRACE_SIZE
+			&& strcmp(spi, HT1632Trace::log) == 0;
+	printf("%-28s %s  %u bits, %u through the SPI\n", "HT1632Spi (2 chips, trace)",
+			ok ? "ok  " : "FAIL", HT1632Trace::length, bytes * 8);
+	return (ok);
+}
+
+bool verifyAll() {
+	HT1632Emulator emulator;
+	bool ok = true;
+
+	{
+		HT1632 matrix(DATA_PIN, WR_PIN, CS_PIN, CS1_PIN, CS2_PIN, CS3_PIN, RD_PIN);
+		HT1632Driver<HT1632MemoryBus<4> > reference;
+		const byte cs[] = { CS_PIN, CS1_PIN, CS2_PIN, CS3_PIN };
+		emulator.begin(4, DATA_PIN, WR_PIN, RD_PIN);
+		for (byte chip = 0; chip < 4; chip++)
+			emulator.chipPin(chip, cs[chip]);
+		ok &= verify<4, false>("HT1632 (4 chips)", matrix, reference, emulator,
+				HT1632_MODULE_8X32, true);
+	}
+	{
+		//No RD: drawPixelDirect() can't read, the nibble comes from the buffer.
+		HT1632 matrix(DATA_PIN, WR_PIN, CS_PIN, CS1_PIN);
+		HT1632Driver<HT1632MemoryBus<2> > reference;
+		emulator.begin(2, DATA_PIN, WR_PIN);
+		emulator.chipPin(0, CS_PIN);
+		emulator.chipPin(1, CS1_PIN);
+		ok &= verify<2, false>("HT1632 (2 chips, no RD)", matrix, reference, emulator,
+				HT1632_MODULE_8X32, false);
+	}
+	{
+		HT1632Fast<DATA_PIN, WR_PIN, CS_PIN, CS1_PIN, 0, 0, RD_PIN> matrix;
+		HT1632Driver<HT1632MemoryBus<2> > reference;
+		emulator.begin(2, DATA_PIN, WR_PIN, RD_PIN);
+		emulator.chipPin(0, CS_PIN);
+		emulator.chipPin(1, CS1_PIN);
+		ok &= verify<2, false>("HT1632Fast (2 chips)", matrix, reference, emulator,
+				HT1632_MODULE_8X32, true);
+	}
+	{
+		HT1632Shift<DATA_PIN, WR_PIN, CSDATA_PIN, CSCLOCK_PIN, 6, RD_PIN> matrix;
+		HT1632Driver<HT1632MemoryBus<6> > reference;
+		emulator.begin(6, DATA_PIN, WR_PIN, RD_PIN);
+		emulator.shiftSelect(CSDATA_PIN, CSCLOCK_PIN);
+		ok &= verify<6, false>("HT1632Shift (6 chips)", matrix, reference, emulator,
+				HT1632_MODULE_8X32, true);
+	}
+	{
+		HT1632Lanes<HT1632FastSelect<CS_PIN, CS1_PIN, CS2_PIN, CS3_PIN>, WR_PIN,
+				LANE0_PIN, LANE1_PIN, LANE2_PIN, LANE3_PIN> matrix;
+		HT1632Driver<HT1632MemoryBus<4> > reference;
+		const byte cs[] = { CS_PIN, CS1_PIN, CS2_PIN, CS3_PIN };
+		emulator.begin(4, LANE0_PIN, WR_PIN);
+		for (byte chip = 0; chip < 4; chip++) {
+			emulator.chipPin(chip, cs[chip]);
+			emulator.dataPin(chip, LANE0_PIN + chip);
+		}
+		ok &= verify<4, true>("HT1632Lanes (4 chips)", matrix, reference, emulator,
+				HT1632_MODULE_8X32, false);
+	}
+	{
+		//Lanes from port bit 1, the transpose is shifted.
+		HT1632Lanes<HT1632FastSelect<CS_PIN, CS1_PIN>, LANE_WR_PIN, LANE1_PIN,
+				LANE2_PIN> matrix;
+		HT1632Driver<HT1632MemoryBus<2> > reference;
+		emulator.begin(2, LANE1_PIN, LANE_WR_PIN);
+		for (byte chip = 0; chip < 2; chip++) {
+			emulator.chipPin(chip, chip ? CS1_PIN : CS_PIN);
+			emulator.dataPin(chip, LANE1_PIN + chip);
+		}
+		ok &= verify<2, true>("HT1632Lanes (WR in the port)", matrix, reference,
+				emulator, HT1632_MODULE_8X32, false);
+	}
+	{
+		//Lanes not in port bit order, bit by bit transpose.
+		HT1632Lanes<HT1632FastSelect<CS_PIN, CS1_PIN>, WR_PIN, LANE3_PIN,
+				LANE1_PIN> matrix;
+		HT1632Driver<HT1632MemoryBus<2> > reference;
+		emulator.begin(2, LANE3_PIN, WR_PIN);
+		emulator.chipPin(0, CS_PIN);
+		emulator.chipPin(1, CS1_PIN);
+		emulator.dataPin(0, LANE3_PIN);
+		emulator.dataPin(1, LANE1_PIN);
+		ok &= verify<2, true>("HT1632Lanes (out of order)", matrix, reference,
+				emulator, HT1632_MODULE_8X32, false);
+	}
+	{
+		HT1632Static<HT1632FastPins<DATA_PIN, WR_PIN, CS_PIN, CS1_PIN, 0, 0, RD_PIN>,
+				HT1632_MODULE_16X24, 2> matrix;
+		HT1632Driver<HT1632MemoryBus<2>, HT1632StaticStorage<HT1632_MODULE_16X24, 2> > reference;
+		emulator.begin(2, DATA_PIN, WR_PIN, RD_PIN);
+		emulator.chipPin(0, CS_PIN);
+		emulator.chipPin(1, CS1_PIN);
+		ok &= verify<2, false>("HT1632Static 16x24 (2 chips)", matrix, reference,
+				emulator, HT1632_MODULE_16X24, true);
+	}
+	{
+		//init() with no module, the reference gets it explicitly.
+		HT1632Static<HT1632FastPins<DATA_PIN, WR_PIN, CS_PIN, CS1_PIN, 0, 0, RD_PIN>,
+				HT1632_MODULE_16X24, 2> matrix;
+		HT1632Driver<HT1632MemoryBus<2> > reference;
+		emulator.begin(2, DATA_PIN, WR_PIN, RD_PIN);
+		emulator.chipPin(0, CS_PIN);
+		emulator.chipPin(1, CS1_PIN);
+		ok &= verify<2, false>("HT1632Static 16x24, init()", matrix, reference,
+				emulator, HT1632_MODULE_16X24, true, true);
+	}
+	{
+		//2x2 grid, the bottom row upside down: 2 bands of mapping tables.
+		HT1632Fast<DATA_PIN, WR_PIN, CS_PIN, CS1_PIN, CS2_PIN, CS3_PIN, RD_PIN> matrix;
+		HT1632Driver<HT1632MemoryBus<4> > reference;
+		const byte cs[] = { CS_PIN, CS1_PIN, CS2_PIN, CS3_PIN };
+		const byte rotations[] = { HT1632_ROTATE_0, HT1632_ROTATE_0,
+				HT1632_ROTATE_180, HT1632_ROTATE_180 };
+		emulator.begin(4, DATA_PIN, WR_PIN, RD_PIN);
+		for (byte chip = 0; chip < 4; chip++)
+			emulator.chipPin(chip, cs[chip]);
+		ok &= verify<4, false>("HT1632Fast 2x2, rotated", matrix, reference,
+				emulator, HT1632_MODULE_8X32, true, false, 2, rotations);
+	}
+	{
+		//The arithmetic mapping of the static storage against the tables.
+		HT1632Static<HT1632FastPins<DATA_PIN, WR_PIN, CS_PIN, CS1_PIN, CS2_PIN, CS3_PIN, RD_PIN>,
+				HT1632_MODULE_16X24 | HT1632_ROTATE_270, 4, 2, HT1632_LAYOUT_ROWS, 2> matrix;
+		HT1632Driver<HT1632MemoryBus<4> > reference;
+		const byte cs[] = { CS_PIN, CS1_PIN, CS2_PIN, CS3_PIN };
+		emulator.begin(4, DATA_PIN, WR_PIN, RD_PIN);
+		for (byte chip = 0; chip < 4; chip++)
+			emulator.chipPin(chip, cs[chip]);
+		ok &= verify<4, false>("HT1632Static 2x2, 270", matrix, reference,
+				emulator, HT1632_MODULE_16X24 | HT1632_ROTATE_270, true, false, 2);
+	}
+	ok &= verifySpi();
+	return (ok);
+}
+
+void vcdReport(const char * name) {
+	HT1632VcdTiming & timing = HT1632Vcd::timing;
+
+	printf("%-12s %4lu selects, %lu without clocks, %5lu WR, %3lu RD clocks",
+			name, timing.selects, timing.emptySelects, timing.clocks, timing.rclocks);
+	if (timing.clocks > 1)
+		printf(", tCLK %lu ns, WR low %lu ns, high %lu ns, tSU %lu ns",
+				HT1632Vcd::nanos(timing.minPeriod), HT1632Vcd::nanos(timing.minLow),
+				HT1632Vcd::nanos(timing.minHigh), HT1632Vcd::nanos(timing.minSetup));
+	printf("\n");
+	HT1632Vcd::resetTiming();
+}
+
+int vcd(const char * path) {
+	HT1632Driver<HT1632Bus<HT1632VcdPins<2> > > matrix;
+
+	if (!HT1632Vcd::open(path, 2)) {
+		printf("Can't write %s\n", path);
+		return (1);
+	}
+	matrix.init();
+	vcdReport("init");
+	matrix.drawString(0, 1, "VCD", 1);
+	matrix.writeScreen();
+	vcdReport("frame");
+	matrix.drawPixel(31, 3, 1);
+	matrix.writeScreen();
+	vcdReport("1 pixel");
+	matrix.drawPixelDirect(30, 3, 1);
+	vcdReport("direct");
+	HT1632Vcd::close();
+	printf("%s: %lu us of bus at %lu Hz\n", path,
+			HT1632Vcd::nanos(HT1632Vcd::cycles()) / 1000, HT1632Vcd::cost.hz);
+	return (0);
+}
+
+int main(int argc, char ** argv) {
+	if (argc > 1 && strcmp(argv[1], "--verify") == 0)
+		return (verifyAll() ? 0 : 1);
+	if (argc > 2 && strcmp(argv[1], "--vcd") == 0)
+		return (vcd(argv[2]));
+
+	HT1632Driver<HT1632MemoryBus<1> > memory;
+	HT1632Driver<HT1632MemoryBus<4> > memory4;
+	HT1632Driver<HT1632MemoryBus<1> > memory16x24;
+	HT1632Driver<HT1632MemoryBus<4> > memory16x24x4;
+	HT1632Driver<HT1632MemoryBus<4>, HT1632StaticStorage<HT1632_MODULE_8X32, 4> > memoryStatic;
+	HT1632Fast<DATA_PIN, WR_PIN, CS_PIN> fast;
+	HT1632Lanes<HT1632FastSelect<CS_PIN, CS1_PIN, CS2_PIN, CS3_PIN>, WR_PIN,
+			LANE0_PIN, LANE1_PIN, LANE2_PIN, LANE3_PIN> lanes;
+
+	memory.init();
+	memory4.init();
+	memory16x24.init(0, HT1632_COM_MODULE, HT1632_MODULE_16X24);
+	memory16x24x4.init(0, HT1632_COM_MODULE, HT1632_MODULE_16X24);
+	memoryStatic.init();
+	fast.init();
+	lanes.init();
+	HT1632Bench::run("HT1632MemoryBus, 1 8x32", memory, HT1632_MODULE_8X32, 1);
+	HT1632Bench::run("HT1632MemoryBus, 4 8x32", memory4, HT1632_MODULE_8X32, 4);
+	HT1632Bench::run("HT1632MemoryBus, 1 16x24", memory16x24, HT1632_MODULE_16X24, 1);
+	HT1632Bench::run("HT1632MemoryBus, 4 16x24", memory16x24x4, HT1632_MODULE_16X24, 4);
+	HT1632Bench::run("HT1632MemoryBus, static 4 8x32", memoryStatic, HT1632_MODULE_8X32, 4);
+	HT1632Bench::run("HT1632Fast (recorded pins), 1 8x32", fast, HT1632_MODULE_8X32, 1);
+	HT1632Bench::runLanes("HT1632Lanes (recorded pins), 4 8x32", lanes, HT1632_MODULE_8X32, 4);
+	return (0);
+}
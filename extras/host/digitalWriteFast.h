@@ -0,0 +1,9 @@
+//Host (HT1632_HOST) version of digitalWriteFast.h: the same calls, recorded.
+#ifndef HT1632_HOST_DIGITALWRITEFAST_H_h
+#define HT1632_HOST_DIGITALWRITEFAST_H_h
+
+#define digitalWriteFast(pin, level)	digitalWrite(pin, level)
+#define digitalReadFast(pin)			digitalRead(pin)
+#define pinModeFast(pin, mode)			pinMode(pin, mode)
+
+#endif